@@ -4,411 +4,6715 @@
 #include <fstream>
 #include <filesystem>
 #include <unordered_set>
+#include <unordered_map>
+#include <set>
+#include <map>
+#include <shared_mutex>
 #include <utility>
+#include <iterator>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <memory>
+#include <string_view>
+#include <cstdint>
+#include <cstdio>
+#include <charconv>
+#include <type_traits>
+#include <deque>
+#include <list>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <regex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/inotify.h>
+#include <sys/sysmacros.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define TEM_IO_URING
+#endif
+#endif
 
 using namespace std;
 namespace fs = filesystem;
 
 /*
 ----------Compilação----------
-g++ -std=c++17 main.cpp -o main
-./main [diretorio_opcional]
+g++ -std=c++17 -O2 -pthread main.cpp -o main
+./main [-j num_threads] [--salvar arquivo.snap] [--stats relatorio.json] [--sem-progresso] [--uso-disco] [diretorio_opcional]
+       (--uso-disco: tamanhos em blocos alocados, cada inode com hardlinks contado uma vez)
+./main --tamanhos-depois [diretorio_opcional]   (mostra a estrutura logo; tamanhos lidos em segundo plano,
+       via io_uring no Linux)
+./main --snapshot arquivo.snap
+./main --snapshot hoje.snap --diff ontem.snap   (diferenças em JSON: adicionados, removidos, alterados e
+       o delta de cada pasta; a referência também pode ser uma pasta)
+./main --snapshot noite.snap --atualizar --salvar noite.snap   (relista só as pastas que mudaram desde o
+       snapshot, comparando inode, mtime e ctime de cada pasta, e grava o snapshot atualizado)
+./main --monitorar [diretorio_opcional]   (Linux: mantém a árvore atualizada via inotify)
+./main [--snapshot arquivo.snap | diretorio] -c maior -c extensao=.log -c vazias -c maiores=N
+       -c pasta-mais-arquivos -c html=saida.html -c html-recolhivel=saida.html
+       -c 'glob=*core*.dmp' -c 'regex=^log_[0-9]+\.txt$' -c duplicados
+       (modo não interativo: resultados em JSON, um por linha)
+./main [--snapshot arquivo.snap | diretorio] [--monitorar] --servir /tmp/arvore.sock
+       (servidor residente: carrega a árvore uma vez e responde as consultas de -c pelo socket Unix,
+       uma por linha, cada resposta terminada por {"fim":true,...}; comandos resumo, atualizar e encerrar)
+./main --conectar /tmp/arvore.sock -c maior -c resumo   (envia as consultas a um servidor --servir)
+./main [-j num_threads] --bench entradas=10K/1M/10M[,ramificacao=16,pastas=0.2,profundidade=0,
+       tamanho_max=16M,extensoes=.txt:4/.log:2/:1,semente=42,disco=/tmp/bench]
+       (benchmark com árvores sintéticas determinísticas; disco= mede também a varredura real)
 */
 
-class FileNode
+// Junta um diretório e um nome de entrada da mesma forma que fs::path::operator/
+// (sem duplicar a barra quando o diretório já termina com '/')
+// @param dir: Caminho do diretório
+// @param nome: Nome da entrada dentro do diretório
+// @return O caminho "dir/nome"
+static string juntarCaminho(const string &dir, string_view nome)
+{
+    string caminho;
+    caminho.reserve(dir.size() + 1 + nome.size());
+    caminho += dir;
+    if (!dir.empty() && dir.back() != '/')
+    {
+        caminho += '/';
+    }
+    caminho += nome;
+    return caminho;
+}
+
+// Extrai a extensão de um nome de arquivo com as mesmas regras de fs::path::extension(),
+// mas sem alocar: tudo a partir do último ponto, exceto quando o ponto inicia o nome
+// @param nome: Nome do arquivo (ex: "relatorio.final.txt")
+// @return A extensão com o ponto (ex: ".txt") ou vazio se não houver
+static string_view extensao(string_view nome)
+{
+    size_t ponto = nome.rfind('.');
+    if (ponto == string_view::npos || ponto == 0)
+    {
+        return {};
+    }
+    return nome.substr(ponto);
+}
+
+// Escritor com buffer grande para saídas volumosas (HTML, texto)
+// @note Os dados são acumulados em memória e gravados no destino em blocos de
+//       "capacidade" bytes com uma única chamada fwrite, sem descarregar a cada
+//       linha. A memória usada é limitada ao buffer, qualquer que seja o tamanho da saída.
+class EscritorBuffer
+{
+public:
+    // @param destino: Arquivo (ou stdout) que recebe os dados; não é fechado pelo escritor
+    // @param capacidade: Tamanho do buffer em bytes
+    explicit EscritorBuffer(FILE *destino, size_t capacidade = 1 << 20)
+        : destino(destino), buffer(new char[capacidade]), capacidade(capacidade) {}
+
+    ~EscritorBuffer() { descarregar(); }
+
+    EscritorBuffer(const EscritorBuffer &) = delete;
+    EscritorBuffer &operator=(const EscritorBuffer &) = delete;
+
+    EscritorBuffer &operator<<(string_view texto)
+    {
+        if (texto.size() > capacidade - usado)
+        {
+            descarregar();
+            if (texto.size() > capacidade)
+            {
+                gravar(texto.data(), texto.size());
+                return *this;
+            }
+        }
+        memcpy(buffer.get() + usado, texto.data(), texto.size());
+        usado += texto.size();
+        return *this;
+    }
+
+    EscritorBuffer &operator<<(char c)
+    {
+        if (usado == capacidade)
+        {
+            descarregar();
+        }
+        buffer[usado++] = c;
+        return *this;
+    }
+
+    template <typename Inteiro, typename = enable_if_t<is_integral_v<Inteiro> && !is_same_v<Inteiro, char> && !is_same_v<Inteiro, bool>>>
+    EscritorBuffer &operator<<(Inteiro n)
+    {
+        char texto[24];
+        auto resultado = to_chars(texto, texto + sizeof(texto), n);
+        return *this << string_view(texto, resultado.ptr - texto);
+    }
+
+    // Grava no destino tudo o que está no buffer
+    void descarregar()
+    {
+        gravar(buffer.get(), usado);
+        usado = 0;
+    }
+
+    // Indica se alguma gravação falhou (disco cheio, pipe fechado, ...)
+    bool falhou() const { return erro; }
+
+private:
+    void gravar(const char *dados, size_t tamanho)
+    {
+        if (tamanho > 0 && fwrite(dados, 1, tamanho, destino) != tamanho)
+        {
+            erro = true;
+        }
+    }
+
+    FILE *destino;
+    unique_ptr<char[]> buffer;
+    size_t capacidade;
+    size_t usado = 0;
+    bool erro = false;
+};
+
+// Escreve um texto escapando os caracteres especiais do HTML (&, <, >, ', ")
+static void escreverHTML(EscritorBuffer &saida, string_view texto)
+{
+    size_t inicio = 0;
+    for (size_t i = 0; i < texto.size(); i++)
+    {
+        const char *troca = nullptr;
+        switch (texto[i])
+        {
+        case '&': troca = "&amp;"; break;
+        case '<': troca = "&lt;"; break;
+        case '>': troca = "&gt;"; break;
+        case '\'': troca = "&#39;"; break;
+        case '"': troca = "&quot;"; break;
+        default: continue;
+        }
+        saida << texto.substr(inicio, i - inicio) << troca;
+        inicio = i + 1;
+    }
+    saida << texto.substr(inicio);
+}
+
+// Escreve um texto como string JSON (com aspas), escapando aspas, barras, caracteres
+// de controle e '<' (para que "</script>" em um nome não feche o bloco de dados do HTML)
+static void escreverJSON(EscritorBuffer &saida, string_view texto)
+{
+    static const char hex[] = "0123456789abcdef";
+    saida << '"';
+    size_t inicio = 0;
+    for (size_t i = 0; i < texto.size(); i++)
+    {
+        unsigned char c = static_cast<unsigned char>(texto[i]);
+        if (c >= 0x20 && c != '"' && c != '\\' && c != '<')
+        {
+            continue;
+        }
+        saida << texto.substr(inicio, i - inicio);
+        if (c == '"' || c == '\\')
+        {
+            saida << '\\' << static_cast<char>(c);
+        }
+        else
+        {
+            saida << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+        }
+        inicio = i + 1;
+    }
+    saida << texto.substr(inicio) << '"';
+}
+
+// Normaliza uma extensão para consulta no índice: minúsculas e com o ponto inicial
+// @param ext: Extensão como digitada (ex: "TXT", ".Log")
+// @return A extensão normalizada (ex: ".txt", ".log")
+static string normalizarExtensao(string_view ext)
+{
+    string normalizada;
+    normalizada.reserve(ext.size() + 1);
+    if (!ext.empty() && ext.front() != '.')
+    {
+        normalizada += '.';
+    }
+    for (char c : ext)
+    {
+        normalizada += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    return normalizada;
+}
+
+// Procura a primeira ocorrência de "agulha" em dados[inicio, tamanho)
+// @return Posição da ocorrência ou string_view::npos
+// @note Compara 16 posições por vez (SSE2 ou NEON): o primeiro e o último byte da
+//       agulha são testados em paralelo e só as posições em que ambos batem passam
+//       pelo memcmp do meio. Sem SIMD disponível, usa memchr no primeiro byte.
+static size_t procurarTrecho(const char *dados, size_t tamanho, size_t inicio, string_view agulha)
+{
+    const size_t k = agulha.size();
+    if (k == 0 || tamanho < k)
+    {
+        return k == 0 ? inicio : string_view::npos;
+    }
+    auto meioIgual = [&](size_t pos)
+    {
+        return k <= 2 || memcmp(dados + pos + 1, agulha.data() + 1, k - 2) == 0;
+    };
+    size_t i = inicio;
+#if defined(__SSE2__)
+    const __m128i primeiro = _mm_set1_epi8(agulha.front());
+    const __m128i ultimo = _mm_set1_epi8(agulha.back());
+    for (; i + k - 1 + 16 <= tamanho; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dados + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dados + i + k - 1));
+        unsigned mascara = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, primeiro), _mm_cmpeq_epi8(b, ultimo))));
+        while (mascara != 0)
+        {
+            size_t pos = i + static_cast<size_t>(__builtin_ctz(mascara));
+            if (meioIgual(pos))
+            {
+                return pos;
+            }
+            mascara &= mascara - 1;
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t primeiro = vdupq_n_u8(static_cast<uint8_t>(agulha.front()));
+    const uint8x16_t ultimo = vdupq_n_u8(static_cast<uint8_t>(agulha.back()));
+    for (; i + k - 1 + 16 <= tamanho; i += 16)
+    {
+        uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t *>(dados + i));
+        uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t *>(dados + i + k - 1));
+        uint8x16_t iguais = vandq_u8(vceqq_u8(a, primeiro), vceqq_u8(b, ultimo));
+        // 4 bits por posição: o equivalente NEON do movemask
+        uint64_t mascara = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(iguais), 4)), 0);
+        while (mascara != 0)
+        {
+            size_t pos = i + static_cast<size_t>(__builtin_ctzll(mascara)) / 4;
+            if (meioIgual(pos))
+            {
+                return pos;
+            }
+            mascara &= ~(0xFull << ((pos - i) * 4));
+        }
+    }
+#endif
+    while (i + k <= tamanho)
+    {
+        const void *achado = memchr(dados + i, agulha.front(), tamanho - k + 1 - i);
+        if (achado == nullptr)
+        {
+            break;
+        }
+        size_t pos = static_cast<size_t>(static_cast<const char *>(achado) - dados);
+        if (dados[pos + k - 1] == agulha.back() && meioIgual(pos))
+        {
+            return pos;
+        }
+        i = pos + 1;
+    }
+    return string_view::npos;
+}
+
+// Verifica se um nome inteiro casa com um padrão glob
+// @note Suporta "*" (qualquer sequência), "?" (um caractere) e classes "[abc]",
+//       "[a-z]" e "[!abc]". Retrocede só até o último "*", então o custo é
+//       O(padrão × nome) no pior caso.
+static bool casaGlob(string_view padrao, string_view nome)
+{
+    // Tenta casar uma classe [..] que começa em padrao[p] com o caractere c
+    // @return Posição logo após o "]" (ou string_view::npos se a classe não fecha)
+    auto classe = [&](size_t p, char c, bool &casou)
+    {
+        size_t q = p + 1;
+        bool negada = q < padrao.size() && (padrao[q] == '!' || padrao[q] == '^');
+        q += negada ? 1 : 0;
+        bool achou = false;
+        for (bool primeiro = true; q < padrao.size() && (primeiro || padrao[q] != ']'); primeiro = false)
+        {
+            if (q + 2 < padrao.size() && padrao[q + 1] == '-' && padrao[q + 2] != ']')
+            {
+                achou |= padrao[q] <= c && c <= padrao[q + 2];
+                q += 3;
+            }
+            else
+            {
+                achou |= padrao[q] == c;
+                q++;
+            }
+        }
+        casou = achou != negada;
+        return q < padrao.size() ? q + 1 : string_view::npos;
+    };
+
+    size_t p = 0, n = 0;
+    size_t estrela = string_view::npos, retorno = 0;
+    while (n < nome.size())
+    {
+        if (p < padrao.size() && padrao[p] == '*')
+        {
+            estrela = p++;
+            retorno = n;
+            continue;
+        }
+        if (p < padrao.size())
+        {
+            bool casou = padrao[p] == '?' || padrao[p] == nome[n];
+            size_t proximo = p + 1;
+            if (padrao[p] == '[')
+            {
+                proximo = classe(p, nome[n], casou);
+                if (proximo == string_view::npos) // "[" sem "]" é um caractere comum
+                {
+                    casou = nome[n] == '[';
+                    proximo = p + 1;
+                }
+            }
+            if (casou)
+            {
+                p = proximo;
+                n++;
+                continue;
+            }
+        }
+        if (estrela == string_view::npos)
+        {
+            return false;
+        }
+        p = estrela + 1;
+        n = ++retorno;
+    }
+    while (p < padrao.size() && padrao[p] == '*')
+    {
+        p++;
+    }
+    return p == padrao.size();
+}
+
+// Padrão de busca por nome: glob (casa o nome inteiro) ou expressão regular (casa
+// qualquer trecho do nome, sintaxe ECMAScript)
+// @note "literal" é o maior trecho fixo que todo nome aceito precisa conter; a busca
+//       o procura no bloco de nomes com procurarTrecho e só roda o glob ou a regex
+//       nos nomes em que ele aparece. Vazio quando o padrão não tem trecho fixo.
+struct PadraoNome
+{
+    bool eh_regex = false;
+    string texto;
+    string literal;
+    regex expressao;
+
+    // Compila um padrão
+    // @param erro: Recebe a mensagem quando a expressão regular é inválida
+    // @return false se o padrão é inválido
+    bool compilar(const string &padrao, bool regex_ecma, string &erro)
+    {
+        eh_regex = regex_ecma;
+        texto = padrao;
+        literal = eh_regex ? literalRegex(padrao) : literalGlob(padrao);
+        if (eh_regex)
+        {
+            try
+            {
+                expressao = regex(padrao, regex::ECMAScript | regex::optimize);
+            }
+            catch (const regex_error &e)
+            {
+                erro = e.what();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool corresponde(string_view nome) const
+    {
+        return eh_regex ? regex_search(nome.begin(), nome.end(), expressao) : casaGlob(texto, nome);
+    }
+
+private:
+    // Maior trecho sem curingas de um glob
+    static string literalGlob(string_view padrao)
+    {
+        string maior, atual;
+        for (size_t i = 0; i < padrao.size(); i++)
+        {
+            char c = padrao[i];
+            if (c == '[')
+            {
+                // Mesma leitura de casaGlob: "!" ou "^" nega a classe e um "]" logo em
+                // seguida é membro, não o fim; "[" sem "]" é um caractere comum
+                size_t primeiro = i + 1;
+                primeiro += primeiro < padrao.size() && (padrao[primeiro] == '!' || padrao[primeiro] == '^') ? 1 : 0;
+                size_t fim = padrao.find(']', primeiro + 1);
+                if (fim == string_view::npos)
+                {
+                    atual += c;
+                    continue;
+                }
+                i = fim;
+            }
+            if (c == '*' || c == '?' || c == '[')
+            {
+                maior = atual.size() > maior.size() ? atual : maior;
+                atual.clear();
+                continue;
+            }
+            atual += c;
+        }
+        return atual.size() > maior.size() ? atual : maior;
+    }
+
+    // Maior trecho fixo obrigatório de uma expressão regular
+    // @note Análise conservadora: alternativas ("|") anulam o literal, só o nível
+    //       mais externo (fora de grupos e classes) é considerado, e um caractere
+    //       seguido de "?", "*" ou "{" sai do trecho por ser opcional.
+    static string literalRegex(string_view padrao)
+    {
+        if (padrao.find('|') != string_view::npos)
+        {
+            return "";
+        }
+        string maior, atual;
+        auto encerrar = [&]
+        {
+            maior = atual.size() > maior.size() ? atual : maior;
+            atual.clear();
+        };
+        int profundidade = 0;
+        for (size_t i = 0; i < padrao.size(); i++)
+        {
+            char c = padrao[i];
+            bool literal = false;
+            if (c == '\\' && i + 1 < padrao.size())
+            {
+                c = padrao[++i];
+                literal = !isalnum(static_cast<unsigned char>(c)); // \d, \w, \b... são classes
+                // Os operandos de \xHH, \uHHHH, \cX e dos escapes numéricos (\0, \1...)
+                // não são texto literal: o trecho termina no escape e eles são pulados
+                size_t operandos = c == 'x' ? 2 : c == 'u' ? 4 : c == 'c' ? 1 : 0;
+                while (isdigit(static_cast<unsigned char>(c)) && i + 1 < padrao.size() &&
+                       isdigit(static_cast<unsigned char>(padrao[i + 1])))
+                {
+                    i++;
+                }
+                i = min(i + operandos, padrao.size() - 1);
+            }
+            else if (c == '[')
+            {
+                // A classe termina no primeiro "]" não escapado ("\]" é membro). Um "]"
+                // logo no início ("[]..." ou "[^]...") tem leituras diferentes entre
+                // implementações de ECMAScript, então nesse caso não há literal seguro
+                size_t fim = i + 1;
+                fim += fim < padrao.size() && padrao[fim] == '^' ? 1 : 0;
+                if (fim < padrao.size() && padrao[fim] == ']')
+                {
+                    return "";
+                }
+                while (fim < padrao.size() && padrao[fim] != ']')
+                {
+                    fim += padrao[fim] == '\\' ? 2 : 1;
+                }
+                i = min(fim, padrao.size());
+            }
+            else if (c == '{')
+            {
+                size_t fim = padrao.find('}', i + 1);
+                i = (fim == string_view::npos) ? padrao.size() : fim;
+            }
+            else if (c == '(')
+            {
+                profundidade++;
+            }
+            else if (c == ')')
+            {
+                profundidade--;
+            }
+            else
+            {
+                literal = strchr(".^$*+?{}", c) == nullptr;
+            }
+            char seguinte = i + 1 < padrao.size() ? padrao[i + 1] : '\0';
+            bool opcional = seguinte == '?' || seguinte == '*' || seguinte == '{';
+            if (!literal || profundidade > 0 || opcional)
+            {
+                encerrar();
+                continue;
+            }
+            atual += c;
+            if (seguinte == '+') // repetido: o trecho continua obrigatório só até aqui
+            {
+                encerrar();
+            }
+        }
+        encerrar();
+        return maior;
+    }
+};
+
+// Índices sobre os nomes dos arquivos
+// @note por_extensao é construído logo após a carga e atualizado a cada arquivo
+//       acrescentado; ids de arquivos removidos ou renomeados continuam nas listas
+//       e são descartados na consulta. Os vetores ordenados por nome (para buscas
+//       por prefixo e sufixo) e a ordem dos arquivos no bloco de nomes (para buscas
+//       por padrão) são opcionais: construídos na primeira consulta e reconstruídos
+//       depois de qualquer alteração na árvore. Só as alterações (feitas com a trava
+//       de escrita da árvore) os invalidam; construir um índice não mexe nos outros,
+//       então leitores simultâneos percorrem vetores que não mudam mais.
+struct IndiceNomes
+{
+    mutex trava; // protege a construção sob demanda quando há vários leitores
+    bool extensoes_prontas = false;
+    unordered_map<string, vector<uint32_t>> por_extensao; // extensão normalizada -> ids
+    bool ordenados_prontos = false;
+    vector<uint32_t> por_nome;           // ids de arquivos ordenados pelo nome
+    vector<uint32_t> por_nome_invertido; // ids ordenados pelo nome lido de trás para frente
+    bool posicoes_prontas = false;
+    vector<uint32_t> por_posicao; // ids de arquivos na ordem em que os nomes aparecem no bloco
+};
+
+// Chave do índice de tamanhos: (tamanho, id do arquivo)
+using ChaveTamanho = pair<int64_t, uint32_t>;
+
+// Ordem do índice de tamanhos: maiores primeiro e, entre tamanhos iguais, menor id primeiro
+struct OrdemTamanhoDecrescente
+{
+    bool operator()(const ChaveTamanho &a, const ChaveTamanho &b) const
+    {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    }
+};
+
+// Índice dos arquivos ordenados por tamanho (do maior para o menor)
+// @note "base" é um vetor ordenado construído uma vez após a carga. As alterações
+//       posteriores (monitoramento, recarga de pastas) vão para dois conjuntos
+//       pequenos, "inseridos" e "removidos", que as consultas intercalam com a base;
+//       quando eles crescem demais, são incorporados à base em uma passada O(n).
+//       Consultas custam O(log n + resultados).
+struct IndiceTamanhos
+{
+    mutex trava; // protege a construção sob demanda quando há vários leitores
+    bool pronto = false;
+    vector<ChaveTamanho> base;
+    set<ChaveTamanho, OrdemTamanhoDecrescente> inseridos;
+    set<ChaveTamanho, OrdemTamanhoDecrescente> removidos;
+};
+
+// Tipo de um nó da árvore, guardado em um único byte
+enum class TipoNo : uint8_t
+{
+    Arquivo = 0,
+    Pasta = 1,
+    Removido = 2, // nó de uma subárvore substituída (não é mais alcançável pela raiz)
+};
+
+// Nome do tipo usado nas saídas (texto e classes CSS do HTML)
+static const char *nomeTipo(TipoNo tipo)
+{
+    return tipo == TipoNo::Arquivo ? "arquivo" : "pasta";
+}
+
+// Registro de tamanho fixo de um nó. Os nós vivem todos em um único vetor e se
+// referenciam por índice (id), então não há ponteiros nem alocações por nó:
+// @note Ocupação: 32 bytes por nó + 4 bytes na lista de filhos do pai + o nome no
+//       bloco compartilhado (sem terminador). O FileNode anterior ocupava 128 bytes
+//       fixos (três std::string de 32 bytes, um long e um vector de 24 bytes), mais
+//       o caminho completo e nomes longos alocados à parte no heap, e os vetores de
+//       filhos com folga de capacidade: algo entre 200 e 300 bytes por nó na prática.
+struct No
+{
+    int64_t tamanho;        // em bytes (0 para pastas)
+    uint32_t nome_inicio;   // deslocamento do nome em ArvoreArquivos::nomes
+    uint32_t pai;           // id do pai (SEM_PAI para a raiz)
+    uint32_t filhos_inicio; // deslocamento da lista de filhos em ArvoreArquivos::filhos
+    uint32_t num_filhos;
+    uint16_t nome_tamanho;
+    TipoNo tipo;
+    uint8_t flags;          // combinação de FLAG_* (ex: FLAG_VINCULO_REPETIDO)
+    uint32_t meta;          // índice em ArvoreArquivos::metas (pastas) ou SEM_META (arquivos)
+};
+static_assert(sizeof(No) == 32, "No deve ter 32 bytes");
+
+// Arquivo cujo inode (hardlink) já foi contado em outro nó: no modo de uso em disco
+// ele continua na árvore com o seu tamanho, mas não entra nos totais das pastas.
+// A árvore guarda os nós de cada inode com hardlinks (inclusive no snapshot): um
+// hardlink visto depois pelo monitor ou por uma recarga entra como repetido, e quando
+// o nó contado sai da árvore outro nó do mesmo inode passa a ser o contado.
+static constexpr uint8_t FLAG_VINCULO_REPETIDO = 1;
+// Arquivo carregado só pela estrutura (d_type), cujo tamanho ainda não foi lido:
+// fica com 0 bytes até o PreenchedorTamanhos (ou o monitor) preenchê-lo
+static constexpr uint8_t FLAG_TAMANHO_PENDENTE = 2;
+
+// Identidade e datas de uma pasta, usadas para saber se o seu conteúdo mudou
+// desde a carga (a data de modificação de uma pasta muda quando entradas são
+// criadas, removidas ou renomeadas nela). Só as pastas têm este registro.
+struct MetaPasta
+{
+    uint64_t inode;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+
+    bool operator==(const MetaPasta &outra) const
+    {
+        return inode == outra.inode && mtime_ns == outra.mtime_ns && ctime_ns == outra.ctime_ns;
+    }
+    bool operator!=(const MetaPasta &outra) const { return !(*this == outra); }
+};
+
+// Extrai a identidade e as datas de uma pasta do resultado de stat
+static MetaPasta metaDe(const struct stat &info)
+{
+#ifdef __APPLE__
+    const timespec &mtime = info.st_mtimespec;
+    const timespec &ctime = info.st_ctimespec;
+#else
+    const timespec &mtime = info.st_mtim;
+    const timespec &ctime = info.st_ctim;
+#endif
+    return {static_cast<uint64_t>(info.st_ino),
+            static_cast<int64_t>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec,
+            static_cast<int64_t>(ctime.tv_sec) * 1000000000 + ctime.tv_nsec};
+}
+
+// Estatísticas agregadas da subárvore de um nó, preenchidas em uma única passada
+// pós-ordem depois da carga (32 bytes por nó, em um vetor paralelo aos nós)
+struct EstatisticasNo
+{
+    int64_t tamanho_total;      // soma dos arquivos da subárvore (o próprio tamanho, para arquivos)
+    uint32_t num_arquivos;      // arquivos abaixo do nó, em qualquer nível
+    uint32_t num_pastas;        // pastas abaixo do nó, em qualquer nível
+    uint32_t profundidade_max;  // níveis abaixo do nó (0 para arquivos e pastas vazias)
+    uint64_t hash;              // hash Merkle da subárvore (ver ArvoreArquivos::hashProprio)
+};
+
+// Hash FNV-1a de 64 bits de um nome (o mesmo valor em qualquer máquina e execução)
+static uint64_t hashNome(string_view nome)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (unsigned char c : nome)
+    {
+        h = (h ^ c) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+// Finalizador do MurmurHash3: espalha os bits de um valor de 64 bits
+static uint64_t misturarHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 33);
+}
+
+// Intervalo contíguo de ids de filhos, usado em laços "for (uint32_t filho : ...)"
+struct IntervaloFilhos
+{
+    const uint32_t *inicio;
+    const uint32_t *fim;
+
+    const uint32_t *begin() const { return inicio; }
+    const uint32_t *end() const { return fim; }
+    size_t size() const { return fim - inicio; }
+    bool empty() const { return inicio == fim; }
+    uint32_t operator[](size_t i) const { return inicio[i]; }
+};
+
+// Opções da exibição da árvore em texto (ArvoreArquivos::mostrar)
+struct OpcoesExibicao
+{
+    int profundidade_max = -1;        // níveis exibidos abaixo do nó inicial (-1 = todos)
+    size_t max_filhos = 0;            // filhos exibidos por pasta, os maiores (0 = todos)
+    bool ordenar_por_tamanho = false; // filhos do maior para o menor tamanho total
+};
+
+// Região de um arquivo mapeada em memória (somente leitura), desfeita no destrutor
+struct MapeamentoArquivo
+{
+    void *inicio = nullptr;
+    size_t tamanho = 0;
+
+    ~MapeamentoArquivo()
+    {
+        if (inicio != nullptr)
+        {
+            munmap(inicio, tamanho);
+        }
+    }
+};
+
+// Vetor que pode tanto ser dono dos seus dados quanto apontar para uma região
+// externa somente leitura (por exemplo, uma seção de um snapshot mapeado com mmap)
+// @note Leituras acessam a região externa diretamente, sem cópia. A primeira
+//       operação que modifica o vetor copia a região para memória própria
+//       (cópia sob demanda), então uma árvore aberta de um snapshot só é
+//       desserializada se for alterada.
+template <typename T>
+class VetorMapeado
+{
+public:
+    // Passa a apontar para "quantidade" elementos em "dados" (que devem continuar válidos)
+    void apontarPara(const T *dados, size_t quantidade)
+    {
+        proprio.clear();
+        proprio.shrink_to_fit();
+        externo = dados;
+        tamanho_externo = quantidade;
+    }
+
+    const T *data() const { return externo ? externo : proprio.data(); }
+    size_t size() const { return externo ? tamanho_externo : proprio.size(); }
+    size_t capacity() const { return externo ? 0 : proprio.capacity(); }
+    bool mapeado() const { return externo != nullptr; }
+
+    const T &operator[](size_t i) const { return data()[i]; }
+    T &operator[](size_t i)
+    {
+        materializar();
+        return proprio[i];
+    }
+
+    void push_back(const T &valor)
+    {
+        materializar();
+        proprio.push_back(valor);
+    }
+    void append(const T *valores, size_t quantidade)
+    {
+        materializar();
+        proprio.insert(proprio.end(), valores, valores + quantidade);
+    }
+    void resize(size_t quantidade)
+    {
+        materializar();
+        proprio.resize(quantidade);
+    }
+    void reserve(size_t quantidade)
+    {
+        materializar();
+        proprio.reserve(quantidade);
+    }
+    // Troca todo o conteúdo (deixa de apontar para a região externa)
+    void substituir(vector<T> &&valores)
+    {
+        externo = nullptr;
+        tamanho_externo = 0;
+        proprio = move(valores);
+    }
+
+private:
+    void materializar()
+    {
+        if (externo != nullptr)
+        {
+            proprio.assign(externo, externo + tamanho_externo);
+            externo = nullptr;
+            tamanho_externo = 0;
+        }
+    }
+
+    vector<T> proprio;
+    const T *externo = nullptr;
+    size_t tamanho_externo = 0;
+};
+
+// Cabeçalho de um snapshot da árvore gravado em disco
+// @note Layout do arquivo (todas as seções alinhadas a 64 bytes, na ordem de bytes da máquina):
+//       [cabeçalho][nós: No × num_nos][estatísticas: EstatisticasNo × num_nos]
+//       [listas de filhos: uint32_t × num_filhos][nomes: bytes_nomes]
+//       [pastas: MetaPasta × num_metas][caminho da raiz]
+//       [hardlinks: RegistroVinculo × num_vinculos]
+//       Os registros têm tamanho fixo, então o arquivo pode ser mapeado com mmap e
+//       consultado diretamente, sem desserialização.
+struct CabecalhoSnapshot
+{
+    char magica[8];            // "ARVSNAP\0"
+    uint32_t versao;           // VERSAO_SNAPSHOT
+    uint32_t ordem_bytes;      // 0x01020304 gravado na ordem da máquina que criou o arquivo
+    uint32_t tamanho_no;       // sizeof(No)
+    uint32_t tamanho_estatisticas; // sizeof(EstatisticasNo)
+    uint32_t tamanho_meta;     // sizeof(MetaPasta)
+    uint32_t opcoes;           // combinação de OPCAO_SNAPSHOT_* (0 nos snapshots antigos)
+    uint64_t num_nos;
+    uint64_t num_filhos;
+    uint64_t bytes_nomes;
+    uint64_t bytes_caminho_raiz;
+    uint64_t num_metas;
+    uint64_t descartados;
+    uint64_t pos_nos;
+    uint64_t pos_estatisticas;
+    uint64_t pos_filhos;
+    uint64_t pos_nomes;
+    uint64_t pos_metas;
+    uint64_t pos_caminho_raiz;
+    uint64_t num_vinculos;
+    uint64_t pos_vinculos;
+};
+
+// Nó de um inode com vários hardlinks, gravado no snapshot (modo de uso em disco)
+struct RegistroVinculo
+{
+    uint64_t dispositivo;
+    uint64_t inode;
+    uint32_t id;
+    uint32_t reservado; // 0
+};
+
+static constexpr uint32_t VERSAO_SNAPSHOT = 4;
+static constexpr uint32_t OPCAO_SNAPSHOT_USO_DISCO = 1; // tamanhos em blocos alocados, hardlinks contados uma vez
+
+// Árvore de arquivos e diretórios em layout compacto
+// @note Todos os nós ficam em um vetor contíguo; os filhos de cada pasta ocupam um
+//       intervalo contíguo do vetor "filhos" (referenciado por deslocamento no nó);
+//       os nomes ficam concatenados em um único bloco de texto. O caminho completo
+//       não é armazenado: é reconstruído sob demanda subindo pelos ids dos pais.
+//       A raiz é sempre o nó 0.
+class ArvoreArquivos
+{
+public:
+    static constexpr uint32_t SEM_PAI = UINT32_MAX;
+    static constexpr uint32_t SEM_META = UINT32_MAX;
+
+    // Cria uma árvore só com a raiz
+    // @param nome: Nome exibido para a raiz
+    // @param caminho: Caminho completo da raiz (base de todos os caminhos reconstruídos)
+    ArvoreArquivos(const string &nome = "", const string &caminho = "")
+        : caminho_raiz(caminho), indice(make_unique<IndiceNomes>()), indice_tamanhos(make_unique<IndiceTamanhos>())
+    {
+        adicionarNo(nome, TipoNo::Pasta, 0, SEM_PAI);
+    }
+
+    // Id da raiz
+    uint32_t raiz() const { return 0; }
+
+    // Número de nós (arquivos e pastas)
+    size_t tamanho() const { return nos.size(); }
+
+    // Acesso ao registro de um nó
+    const No &no(uint32_t id) const { return nos[id]; }
+
+    // Nome de um nó (visão sobre o bloco de nomes, válida até o próximo nó adicionado)
+    string_view nome(uint32_t id) const
+    {
+        return string_view(nomes.data() + nos[id].nome_inicio, nos[id].nome_tamanho);
+    }
+
+    bool ehArquivo(uint32_t id) const { return nos[id].tipo == TipoNo::Arquivo; }
+
+    // Filhos diretos de um nó
+    IntervaloFilhos filhosDe(uint32_t id) const
+    {
+        const uint32_t *inicio = filhos.data() + nos[id].filhos_inicio;
+        return {inicio, inicio + nos[id].num_filhos};
+    }
+
+    // Reconstrói o caminho completo de um nó a partir dos pais
+    // @param id: Nó desejado
+    // @return O caminho da raiz seguido dos nomes de cada ancestral até o nó
+    string caminho(uint32_t id) const
+    {
+        if (id == raiz())
+        {
+            return caminho_raiz;
+        }
+        vector<uint32_t> ancestrais;
+        for (uint32_t atual = id; atual != raiz(); atual = nos[atual].pai)
+        {
+            ancestrais.push_back(atual);
+        }
+        string resultado = caminho_raiz;
+        for (auto it = ancestrais.rbegin(); it != ancestrais.rend(); ++it)
+        {
+            resultado = juntarCaminho(resultado, nome(*it));
+        }
+        return resultado;
+    }
+
+    // Adiciona um nó sem filhos à árvore (usado na construção)
+    // @param nome: Nome do arquivo ou pasta
+    // @param tipo: Tipo do nó
+    // @param tamanho: Tamanho em bytes (0 para pastas)
+    // @param pai: Id do pai (a lista de filhos do pai é definida à parte com definirFilhos)
+    // @return O id do novo nó
+    uint32_t adicionarNo(string_view nome, TipoNo tipo, int64_t tamanho, uint32_t pai)
+    {
+        reservarDeslocamentos(nome.size(), 0);
+        No novo{};
+        novo.tamanho = tamanho;
+        novo.nome_inicio = static_cast<uint32_t>(nomes.size());
+        novo.nome_tamanho = static_cast<uint16_t>(nome.size());
+        novo.pai = pai;
+        novo.tipo = tipo;
+        novo.meta = SEM_META;
+        nomes.append(nome.data(), nome.size());
+        nos.push_back(novo);
+        uint32_t id = static_cast<uint32_t>(nos.size() - 1);
+        if (tipo == TipoNo::Arquivo)
+        {
+            indexarArquivo(id);
+            indexarTamanho(tamanho, id, true);
+            indice->ordenados_prontos = false;
+            indice->posicoes_prontas = false;
+        }
+        return id;
+    }
+
+    // Define os filhos de uma pasta como um intervalo contíguo de ids
+    // @param pai: Pasta que recebe os filhos
+    // @param primeiro: Id do primeiro filho
+    // @param quantidade: Quantidade de filhos (ids primeiro, primeiro+1, ...)
+    void definirFilhos(uint32_t pai, uint32_t primeiro, uint32_t quantidade)
+    {
+        reservarDeslocamentos(0, quantidade);
+        nos[pai].filhos_inicio = static_cast<uint32_t>(filhos.size());
+        nos[pai].num_filhos = quantidade;
+        for (uint32_t i = 0; i < quantidade; i++)
+        {
+            filhos.push_back(primeiro + i);
+        }
+    }
+
+    // Reserva espaço para a quantidade esperada de nós e de bytes de nomes
+    void reservar(size_t num_nos, size_t bytes_nomes)
+    {
+        nos.reserve(num_nos);
+        filhos.reserve(num_nos);
+        nomes.reserve(bytes_nomes);
+        estatisticas_nos.reserve(num_nos);
+    }
+
+    // Memória ocupada pela árvore, em bytes (capacidade dos vetores)
+    size_t bytesUsados() const
+    {
+        return nos.capacity() * sizeof(No) + filhos.capacity() * sizeof(uint32_t) + nomes.capacity() +
+               estatisticas_nos.capacity() * sizeof(EstatisticasNo) + metas.capacity() * sizeof(MetaPasta);
+    }
+
+    // Estatísticas agregadas (em cache) da subárvore de um nó
+    const EstatisticasNo &estatisticas(uint32_t id) const { return estatisticas_nos[id]; }
+
+    // Hash Merkle de um nó sem a parcela do próprio nome e tipo: pastas com o mesmo
+    // conteúdo têm o mesmo valor, qualquer que seja o nome delas
+    uint64_t hashConteudo(uint32_t id) const { return estatisticas_nos[id].hash - hashProprio(id); }
+
+    // Preenche as estatísticas de todos os nós de uma subárvore em uma única passada
+    // @param id: Raiz da subárvore a recalcular
+    // @note Os nós são coletados em pré-ordem e processados de trás para frente, o que
+    //       garante que todo filho é processado antes do pai (pós-ordem) sem recursão.
+    //       Cada nó é visitado uma vez: O(n) no total, em vez de O(n × profundidade)
+    //       das somas recursivas repetidas em cada pasta.
+    void recalcularSubarvore(uint32_t id)
+    {
+        estatisticas_nos.resize(nos.size());
+        vector<uint32_t> ordem;
+        vector<uint32_t> pilha{id};
+        while (!pilha.empty())
+        {
+            uint32_t atual = pilha.back();
+            pilha.pop_back();
+            ordem.push_back(atual);
+            for (uint32_t filho : filhosDe(atual))
+            {
+                pilha.push_back(filho);
+            }
+        }
+        for (auto it = ordem.rbegin(); it != ordem.rend(); ++it)
+        {
+            agregarFilhos(*it);
+        }
+    }
+
+    // Identidade e datas registradas para uma pasta (nullptr se não houver registro)
+    const MetaPasta *metaPasta(uint32_t id) const
+    {
+        return nos[id].meta == SEM_META ? nullptr : &metas[nos[id].meta];
+    }
+
+    // Registra (ou atualiza) a identidade e as datas de uma pasta
+    void definirMeta(uint32_t id, const MetaPasta &meta)
+    {
+        if (nos[id].meta == SEM_META)
+        {
+            nos[id].meta = static_cast<uint32_t>(metas.size());
+            metas.push_back(meta);
+        }
+        else
+        {
+            metas[nos[id].meta] = meta;
+        }
+    }
+
+    // Procura um filho direto pelo nome
+    // @return O id do filho ou SEM_PAI se a pasta não tiver uma entrada com esse nome
+    uint32_t filhoPorNome(uint32_t pasta, string_view nome_filho) const
+    {
+        for (uint32_t filho : filhosDe(pasta))
+        {
+            if (nome(filho) == nome_filho)
+            {
+                return filho;
+            }
+        }
+        return SEM_PAI;
+    }
+
+    // Acrescenta um novo arquivo ou pasta (vazia) a uma pasta existente
+    // @param pai: Pasta que recebe o novo item
+    // @param nome_filho: Nome do item
+    // @param tipo: Tipo do item
+    // @param tamanho: Tamanho em bytes (0 para pastas)
+    // @return O id do novo nó
+    // @note As estatísticas dos ancestrais são ajustadas pela diferença (O(profundidade))
+    uint32_t adicionarFilho(uint32_t pai, string_view nome_filho, TipoNo tipo, int64_t tamanho, uint8_t flags = 0)
+    {
+        uint32_t id = adicionarNo(nome_filho, tipo, tamanho, pai);
+        nos[id].flags = flags;
+        anexarNaLista(pai, id);
+        estatisticas_nos.resize(nos.size());
+        agregarFilhos(id);
+        const EstatisticasNo &est = estatisticas_nos[id];
+        aplicarDelta(pai, est.tamanho_total, tipo == TipoNo::Arquivo ? 1 : 0, tipo == TipoNo::Pasta ? 1 : 0);
+        trocarParcelaHash(pai, 0, misturarHash(est.hash));
+        corrigirProfundidade(pai);
+        return id;
+    }
+
+    // Acrescenta um arquivo lido do disco a uma pasta, contando cada inode com
+    // hardlinks uma única vez no modo de uso em disco
+    // @param info: Resultado de lstat do arquivo
+    // @return O id do novo nó
+    uint32_t adicionarArquivo(uint32_t pai, string_view nome_filho, const struct stat &info)
+    {
+        uint32_t id = static_cast<uint32_t>(nos.size()); // id que o novo nó vai receber
+        bool repetido = uso_disco && info.st_nlink > 1 &&
+                        !registrarVinculo(id, static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino));
+        return adicionarFilho(pai, nome_filho, TipoNo::Arquivo, tamanhoArquivo(info), repetido ? FLAG_VINCULO_REPETIDO : 0);
+    }
+
+    // Registra um nó de um inode com vários hardlinks (modo de uso em disco)
+    // @param id: Arquivo com o inode
+    // @return true se "id" passa a ser o nó contado nos totais; false se outro nó
+    //         ainda presente na árvore já é (e "id" deve ser marcado como repetido)
+    bool registrarVinculo(uint32_t id, uint64_t dispositivo, uint64_t inode)
+    {
+        pair<uint64_t, uint64_t> chave{dispositivo, inode};
+        GrupoVinculo &grupo = vinculos[chave];
+        if (inode_vinculo.try_emplace(id, chave).second)
+        {
+            grupo.nos.push_back(id);
+        }
+        if (grupo.contado != SEM_PAI && grupo.contado != id && ehArquivo(grupo.contado))
+        {
+            return false;
+        }
+        grupo.contado = id;
+        return true;
+    }
+
+    // Quantidade de hardlinks que passaram a ser contados porque o nó contado do
+    // mesmo inode saiu da árvore
+    uint64_t vinculosPromovidos() const { return vinculos_promovidos; }
+
+    // Remove um nó (e toda a sua subárvore) da pasta que o contém
+    void removerFilho(uint32_t id)
+    {
+        uint32_t pai = nos[id].pai;
+        desligar(id);
+        descartarDescendentes(id);
+        if (ehArquivo(id))
+        {
+            indexarTamanho(nos[id].tamanho, id, false);
+            esquecerVinculo(id);
+        }
+        nos[id].tipo = TipoNo::Removido;
+        nomes_sem_uso += nos[id].nome_tamanho;
+        descartados++;
+        corrigirProfundidade(pai);
+        promoverVinculos();
+        indice->ordenados_prontos = false;
+        indice->posicoes_prontas = false;
+    }
+
+    // Move um nó para outra pasta e/ou outro nome, preservando o id e a subárvore
+    // @param id: Nó a mover
+    // @param novo_pai: Pasta de destino
+    // @param novo_nome: Nome no destino
+    void mover(uint32_t id, uint32_t novo_pai, string_view novo_nome)
+    {
+        reservarDeslocamentos(novo_nome.size(), 0);
+        uint32_t pai_antigo = nos[id].pai;
+        desligar(id);
+        corrigirProfundidade(pai_antigo);
+        if (nome(id) != novo_nome)
+        {
+            nomes_sem_uso += nos[id].nome_tamanho;
+            bool mesma_extensao = normalizarExtensao(extensao(nome(id))) == normalizarExtensao(extensao(novo_nome));
+            uint64_t proprio_antes = hashProprio(id);
+            nos[id].nome_inicio = static_cast<uint32_t>(nomes.size());
+            nos[id].nome_tamanho = static_cast<uint16_t>(novo_nome.size());
+            nomes.append(novo_nome.data(), novo_nome.size());
+            estatisticas_nos[id].hash += hashProprio(id) - proprio_antes;
+            if (ehArquivo(id) && !mesma_extensao)
+            {
+                indexarArquivo(id);
+            }
+            indice->ordenados_prontos = false;
+            indice->posicoes_prontas = false;
+        }
+        nos[id].pai = novo_pai;
+        anexarNaLista(novo_pai, id);
+        const EstatisticasNo &est = estatisticas_nos[id];
+        bool arquivo = ehArquivo(id);
+        aplicarDelta(novo_pai, est.tamanho_total, est.num_arquivos + (arquivo ? 1 : 0), est.num_pastas + (arquivo ? 0 : 1));
+        trocarParcelaHash(novo_pai, 0, misturarHash(est.hash));
+        corrigirProfundidade(novo_pai);
+    }
+
+    // Altera o tamanho de um arquivo e propaga a diferença para os ancestrais
+    void alterarTamanho(uint32_t id, int64_t novo_tamanho)
+    {
+        nos[id].flags &= ~FLAG_TAMANHO_PENDENTE;
+        int64_t delta = novo_tamanho - nos[id].tamanho;
+        if (delta == 0)
+        {
+            return;
+        }
+        indexarTamanho(nos[id].tamanho, id, false);
+        indexarTamanho(novo_tamanho, id, true);
+        nos[id].tamanho = novo_tamanho;
+        uint64_t hash_antes = estatisticas_nos[id].hash;
+        estatisticas_nos[id].hash = hashProprio(id);
+        trocarParcelaHash(nos[id].pai, misturarHash(hash_antes), misturarHash(estatisticas_nos[id].hash));
+        if (nos[id].flags & FLAG_VINCULO_REPETIDO)
+        {
+            return; // já contado pelo primeiro nó do mesmo inode
+        }
+        estatisticas_nos[id].tamanho_total = novo_tamanho;
+        aplicarDelta(nos[id].pai, delta, 0, 0);
+    }
+
+    // Encontra o nó correspondente a um caminho
+    // @param caminho_busca: Caminho absoluto (dentro da raiz) ou relativo à raiz
+    // @return O id do nó ou SEM_PAI se o caminho não existir na árvore
+    uint32_t localizar(const string &caminho_busca) const
+    {
+        string_view resto = caminho_busca;
+        if (resto.substr(0, caminho_raiz.size()) == caminho_raiz)
+        {
+            resto.remove_prefix(caminho_raiz.size());
+        }
+        uint32_t atual = raiz();
+        while (!resto.empty())
+        {
+            size_t barra = resto.find('/');
+            string_view parte = resto.substr(0, barra);
+            resto = (barra == string_view::npos) ? string_view() : resto.substr(barra + 1);
+            if (parte.empty() || parte == ".")
+            {
+                continue;
+            }
+            uint32_t encontrado = SEM_PAI;
+            for (uint32_t filho : filhosDe(atual))
+            {
+                if (nome(filho) == parte)
+                {
+                    encontrado = filho;
+                    break;
+                }
+            }
+            if (encontrado == SEM_PAI)
+            {
+                return SEM_PAI;
+            }
+            atual = encontrado;
+        }
+        return atual;
+    }
+
+    // Substitui o conteúdo de uma pasta pelo conteúdo da raiz de outra árvore
+    // @param destino: Pasta desta árvore que recebe o novo conteúdo
+    // @param sub: Árvore recém-carregada a partir do caminho de "destino"
+    // @note Os nós de "sub" são acrescentados ao final dos vetores (os ids existentes
+    //       não mudam), com as suas flags; os descendentes antigos de "destino" são
+    //       marcados como Removido. Um inode com hardlinks contado em "sub" que já é
+    //       contado por outro nó desta árvore passa a ser repetido; um inode cujo nó
+    //       contado estava entre os descendentes antigos passa para outro nó dele
+    //       (promoverVinculos). As estatísticas
+    //       da nova subárvore são recalculadas e os ancestrais recebem só a
+    //       diferença, com custo proporcional à subárvore e à profundidade.
+    void enxertar(uint32_t destino, const ArvoreArquivos &sub)
+    {
+        const EstatisticasNo antes = estatisticas_nos[destino];
+        indice->ordenados_prontos = false;
+        indice->posicoes_prontas = false;
+        descartarDescendentes(destino);
+        promoverVinculos();
+        reservarDeslocamentos(0, sub.filhos.size());
+
+        const uint32_t base = static_cast<uint32_t>(nos.size()) - 1; // id novo = base + id em sub
+        auto mapear = [&](uint32_t id_sub)
+        { return id_sub == sub.raiz() ? destino : base + id_sub; };
+
+        for (uint32_t id_sub = 1; id_sub < sub.tamanho(); id_sub++)
+        {
+            const No &original = sub.nos[id_sub];
+            uint32_t id = adicionarNo(sub.nome(id_sub), original.tipo, original.tamanho, mapear(original.pai));
+            nos[id].flags = original.flags;
+        }
+        for (const auto &[chave, grupo] : sub.vinculos)
+        {
+            // O nó contado em "sub" primeiro: ele continua contado se o inode não tiver outro nó aqui
+            vector<uint32_t> ordem{grupo.contado};
+            for (uint32_t id_sub : grupo.nos)
+            {
+                if (id_sub != grupo.contado)
+                {
+                    ordem.push_back(id_sub);
+                }
+            }
+            for (uint32_t id_sub : ordem)
+            {
+                if (id_sub != SEM_PAI)
+                {
+                    definirVinculoRepetido(mapear(id_sub), !registrarVinculo(mapear(id_sub), chave.first, chave.second));
+                }
+            }
+        }
+        for (uint32_t id_sub = 0; id_sub < sub.tamanho(); id_sub++)
+        {
+            No &novo = nos[mapear(id_sub)];
+            novo.filhos_inicio = static_cast<uint32_t>(filhos.size());
+            novo.num_filhos = sub.nos[id_sub].num_filhos;
+            for (uint32_t filho : sub.filhosDe(id_sub))
+            {
+                filhos.push_back(mapear(filho));
+            }
+            if (const MetaPasta *meta = sub.metaPasta(id_sub))
+            {
+                definirMeta(mapear(id_sub), *meta);
+            }
+        }
+
+        recalcularSubarvore(destino);
+        const EstatisticasNo &depois = estatisticas_nos[destino];
+        if (nos[destino].pai != SEM_PAI)
+        {
+            aplicarDelta(nos[destino].pai, depois.tamanho_total - antes.tamanho_total,
+                         int64_t(depois.num_arquivos) - antes.num_arquivos,
+                         int64_t(depois.num_pastas) - antes.num_pastas);
+            trocarParcelaHash(nos[destino].pai, misturarHash(antes.hash), misturarHash(depois.hash));
+            corrigirProfundidade(nos[destino].pai);
+        }
+    }
+
+    // Quantidade de nós marcados como Removido (espaço ainda ocupado nos vetores)
+    size_t nosDescartados() const { return descartados; }
+
+    // Caminho completo da raiz
+    const string &caminhoRaiz() const { return caminho_raiz; }
+
+    // Indica se a árvore está sendo lida diretamente de um snapshot mapeado
+    bool mapeada() const { return nos.mapeado(); }
+
+    // Indica se os tamanhos são de uso em disco (blocos alocados, hardlinks contados uma vez)
+    bool usoDisco() const { return uso_disco; }
+    void definirUsoDisco(bool ativo) { uso_disco = ativo; }
+
+    // Tamanho de um arquivo segundo o modo da árvore
+    // @param info: Resultado de stat do arquivo
+    // @return st_blocks × 512 no modo de uso em disco; senão o tamanho aparente (st_size)
+    int64_t tamanhoArquivo(const struct stat &info) const
+    {
+        return uso_disco ? static_cast<int64_t>(info.st_blocks) * 512 : static_cast<int64_t>(info.st_size);
+    }
+
+    // Marca um arquivo como hardlink repetido (fora dos totais); usado na construção,
+    // antes de recalcularSubarvore
+    void marcarVinculoRepetido(uint32_t id) { nos[id].flags |= FLAG_VINCULO_REPETIDO; }
+
+    // Marca um arquivo cujo tamanho ainda será lido (usado na construção)
+    void marcarTamanhoPendente(uint32_t id) { nos[id].flags |= FLAG_TAMANHO_PENDENTE; }
+    bool tamanhoPendente(uint32_t id) const { return (nos[id].flags & FLAG_TAMANHO_PENDENTE) != 0; }
+
+    // Preenche o tamanho de um arquivo pendente e propaga a diferença para os ancestrais
+    // @param id: Arquivo marcado com FLAG_TAMANHO_PENDENTE
+    // @param tamanho: Tamanho lido do disco
+    // @param repetido: O inode já foi contado em outro nó (modo de uso em disco)
+    // @note Não faz nada se o arquivo deixou de estar pendente (o monitor já registrou
+    //       um tamanho mais novo) ou foi removido
+    void preencherTamanho(uint32_t id, int64_t tamanho, bool repetido)
+    {
+        if (!ehArquivo(id) || !tamanhoPendente(id))
+        {
+            return;
+        }
+        if (repetido)
+        {
+            nos[id].flags = (nos[id].flags & ~FLAG_TAMANHO_PENDENTE) | FLAG_VINCULO_REPETIDO;
+        }
+        alterarTamanho(id, tamanho);
+    }
+
+    // Grava a árvore (nós, estatísticas, filhos e nomes) em um arquivo de snapshot
+    // @param arquivo_saida: Caminho do arquivo a ser criado
+    // @return true se o arquivo foi gravado por completo
+    // @note Grava em "arquivo_saida.tmp" e renomeia no fim: substituir o próprio
+    //       snapshot de onde a árvore foi aberta não corrompe o mapeamento em uso.
+    bool salvarSnapshot(const string &arquivo_saida) const
+    {
+        auto alinhar = [](uint64_t pos)
+        { return (pos + 63) & ~uint64_t(63); };
+
+        CabecalhoSnapshot cab{};
+        memcpy(cab.magica, "ARVSNAP", 8);
+        cab.versao = VERSAO_SNAPSHOT;
+        cab.ordem_bytes = 0x01020304;
+        cab.tamanho_no = sizeof(No);
+        cab.tamanho_estatisticas = sizeof(EstatisticasNo);
+        cab.tamanho_meta = sizeof(MetaPasta);
+        cab.opcoes = uso_disco ? OPCAO_SNAPSHOT_USO_DISCO : 0;
+        cab.num_nos = nos.size();
+        cab.num_filhos = filhos.size();
+        cab.bytes_nomes = nomes.size();
+        cab.bytes_caminho_raiz = caminho_raiz.size();
+        cab.num_metas = metas.size();
+        cab.descartados = descartados;
+        cab.pos_nos = alinhar(sizeof(CabecalhoSnapshot));
+        cab.pos_estatisticas = alinhar(cab.pos_nos + cab.num_nos * sizeof(No));
+        cab.pos_filhos = alinhar(cab.pos_estatisticas + cab.num_nos * sizeof(EstatisticasNo));
+        cab.pos_nomes = alinhar(cab.pos_filhos + cab.num_filhos * sizeof(uint32_t));
+        cab.pos_metas = alinhar(cab.pos_nomes + cab.bytes_nomes);
+        cab.pos_caminho_raiz = alinhar(cab.pos_metas + cab.num_metas * sizeof(MetaPasta));
+        vector<RegistroVinculo> registros;
+        for (const auto &[chave, grupo] : vinculos)
+        {
+            for (uint32_t id : grupo.nos)
+            {
+                registros.push_back({chave.first, chave.second, id, 0});
+            }
+        }
+        cab.num_vinculos = registros.size();
+        cab.pos_vinculos = alinhar(cab.pos_caminho_raiz + cab.bytes_caminho_raiz);
+
+        const string temporario = arquivo_saida + ".tmp";
+        FILE *arquivo = fopen(temporario.c_str(), "wb");
+        if (arquivo == nullptr)
+        {
+            return false;
+        }
+        bool falhou;
+        {
+            EscritorBuffer saida(arquivo, 4 << 20);
+            uint64_t pos = 0;
+            auto secao = [&](uint64_t inicio, const void *dados, size_t tamanho)
+            {
+                for (; pos < inicio; pos++)
+                {
+                    saida << '\0';
+                }
+                saida << string_view(static_cast<const char *>(dados), tamanho);
+                pos += tamanho;
+            };
+            secao(0, &cab, sizeof(cab));
+            secao(cab.pos_nos, nos.data(), cab.num_nos * sizeof(No));
+            secao(cab.pos_estatisticas, estatisticas_nos.data(), cab.num_nos * sizeof(EstatisticasNo));
+            secao(cab.pos_filhos, filhos.data(), cab.num_filhos * sizeof(uint32_t));
+            secao(cab.pos_nomes, nomes.data(), cab.bytes_nomes);
+            secao(cab.pos_metas, metas.data(), cab.num_metas * sizeof(MetaPasta));
+            secao(cab.pos_caminho_raiz, caminho_raiz.data(), caminho_raiz.size());
+            secao(cab.pos_vinculos, registros.data(), registros.size() * sizeof(RegistroVinculo));
+            saida.descarregar();
+            falhou = saida.falhou();
+        }
+        if (fclose(arquivo) != 0 || falhou || rename(temporario.c_str(), arquivo_saida.c_str()) != 0)
+        {
+            remove(temporario.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Abre um snapshot mapeando-o em memória; as consultas passam a ler direto do arquivo
+    // @param arquivo_entrada: Caminho do snapshot
+    // @param erro: Recebe a descrição do problema quando a abertura falha
+    // @return true se o snapshot é válido e foi mapeado
+    // @note O cabeçalho, os limites e o alinhamento de cada seção, as referências de
+    //       cada nó (nome, pai, intervalo de filhos, registro de pasta) e a forma da
+    //       árvore (cada nó vivo alcançável pela raiz uma única vez, pela lista do seu
+    //       pai) são conferidos antes do primeiro uso, para que um arquivo truncado ou
+    //       corrompido seja recusado em vez de causar leituras fora do mapeamento ou
+    //       laços infinitos. A conferência é uma passada sequencial pelos nós e filhos
+    //       e um percurso com um bit por nó; os nomes e as estatísticas só são lidos do
+    //       disco conforme forem acessados.
+    bool abrirSnapshot(const string &arquivo_entrada, string &erro)
+    {
+        int fd = open(arquivo_entrada.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            erro = strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CabecalhoSnapshot))
+        {
+            close(fd);
+            erro = "arquivo muito pequeno";
+            return false;
+        }
+        auto mapa = make_shared<MapeamentoArquivo>();
+        mapa->tamanho = info.st_size;
+        mapa->inicio = mmap(nullptr, mapa->tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapa->inicio == MAP_FAILED)
+        {
+            mapa->inicio = nullptr;
+            erro = strerror(errno);
+            return false;
+        }
+
+        const char *base = static_cast<const char *>(mapa->inicio);
+        CabecalhoSnapshot cab;
+        memcpy(&cab, base, sizeof(cab));
+        if (memcmp(cab.magica, "ARVSNAP", 8) != 0)
+        {
+            erro = "nao e um snapshot da arvore";
+            return false;
+        }
+        if (cab.versao != VERSAO_SNAPSHOT || cab.ordem_bytes != 0x01020304 ||
+            cab.tamanho_no != sizeof(No) || cab.tamanho_estatisticas != sizeof(EstatisticasNo) ||
+            cab.tamanho_meta != sizeof(MetaPasta))
+        {
+            erro = "versao ou formato de snapshot incompativel";
+            return false;
+        }
+        // Cada seção precisa caber no arquivo (sem estourar a conta) e estar alinhada ao seu tipo
+        auto secaoValida = [&](uint64_t pos, uint64_t quantidade, size_t tamanho_item, size_t alinhamento)
+        {
+            return pos % alinhamento == 0 && pos <= mapa->tamanho && quantidade <= (mapa->tamanho - pos) / tamanho_item;
+        };
+        if (cab.num_nos == 0 || cab.num_nos >= SEM_PAI || cab.num_filhos > UINT32_MAX || cab.bytes_nomes > UINT32_MAX ||
+            cab.num_metas >= SEM_META ||
+            !secaoValida(cab.pos_nos, cab.num_nos, sizeof(No), alignof(No)) ||
+            !secaoValida(cab.pos_estatisticas, cab.num_nos, sizeof(EstatisticasNo), alignof(EstatisticasNo)) ||
+            !secaoValida(cab.pos_filhos, cab.num_filhos, sizeof(uint32_t), alignof(uint32_t)) ||
+            !secaoValida(cab.pos_nomes, cab.bytes_nomes, 1, 1) ||
+            !secaoValida(cab.pos_metas, cab.num_metas, sizeof(MetaPasta), alignof(MetaPasta)) ||
+            !secaoValida(cab.pos_caminho_raiz, cab.bytes_caminho_raiz, 1, 1) ||
+            !secaoValida(cab.pos_vinculos, cab.num_vinculos, sizeof(RegistroVinculo), alignof(RegistroVinculo)))
+        {
+            erro = "snapshot truncado";
+            return false;
+        }
+
+        // Referências de cada nó e da lista de filhos
+        const No *nos_arquivo = reinterpret_cast<const No *>(base + cab.pos_nos);
+        for (uint64_t id = 0; id < cab.num_nos; id++)
+        {
+            const No &no = nos_arquivo[id];
+            bool valido = static_cast<uint8_t>(no.tipo) <= static_cast<uint8_t>(TipoNo::Removido) &&
+                          uint64_t(no.nome_inicio) + no.nome_tamanho <= cab.bytes_nomes &&
+                          (id == 0 ? no.pai == SEM_PAI : no.pai < cab.num_nos) &&
+                          uint64_t(no.filhos_inicio) + no.num_filhos <= cab.num_filhos &&
+                          (no.meta == SEM_META || no.meta < cab.num_metas);
+            if (!valido)
+            {
+                erro = "snapshot corrompido (no " + to_string(id) + ")";
+                return false;
+            }
+        }
+        const uint32_t *filhos_arquivo = reinterpret_cast<const uint32_t *>(base + cab.pos_filhos);
+        for (uint64_t i = 0; i < cab.num_filhos; i++)
+        {
+            if (filhos_arquivo[i] == 0 || filhos_arquivo[i] >= cab.num_nos)
+            {
+                erro = "snapshot corrompido (lista de filhos)";
+                return false;
+            }
+        }
+        // Estrutura: partindo da raiz, cada nó vivo aparece em exatamente uma lista, a
+        // da pasta indicada no seu "pai"; só pastas têm filhos e os nós removidos ficam
+        // fora das listas. Assim ciclos e pais trocados não chegam às consultas.
+        vector<bool> visto(cab.num_nos, false);
+        vector<uint32_t> pilha{0};
+        visto[0] = true;
+        bool estrutura_valida = nos_arquivo[0].tipo == TipoNo::Pasta;
+        while (estrutura_valida && !pilha.empty())
+        {
+            uint32_t pasta = pilha.back();
+            pilha.pop_back();
+            const No &no = nos_arquivo[pasta];
+            estrutura_valida = no.tipo == TipoNo::Pasta || no.num_filhos == 0;
+            for (uint32_t i = 0; estrutura_valida && i < no.num_filhos; i++)
+            {
+                uint32_t filho = filhos_arquivo[no.filhos_inicio + i];
+                estrutura_valida = !visto[filho] && nos_arquivo[filho].pai == pasta &&
+                                   nos_arquivo[filho].tipo != TipoNo::Removido;
+                visto[filho] = true;
+                pilha.push_back(filho);
+            }
+        }
+        for (uint64_t id = 0; estrutura_valida && id < cab.num_nos; id++)
+        {
+            estrutura_valida = visto[id] || (nos_arquivo[id].tipo == TipoNo::Removido && nos_arquivo[id].num_filhos == 0);
+        }
+        if (!estrutura_valida)
+        {
+            erro = "snapshot corrompido (estrutura da arvore)";
+            return false;
+        }
+        // O registro de hardlinks é pequeno e muda a cada remoção: é copiado do arquivo
+        const RegistroVinculo *registros = reinterpret_cast<const RegistroVinculo *>(base + cab.pos_vinculos);
+        map<pair<uint64_t, uint64_t>, GrupoVinculo> vinculos_lidos;
+        unordered_map<uint32_t, pair<uint64_t, uint64_t>> inode_lido;
+        for (uint64_t i = 0; i < cab.num_vinculos; i++)
+        {
+            const RegistroVinculo &registro = registros[i];
+            pair<uint64_t, uint64_t> chave{registro.dispositivo, registro.inode};
+            if (registro.id >= cab.num_nos || nos_arquivo[registro.id].tipo != TipoNo::Arquivo ||
+                !inode_lido.emplace(registro.id, chave).second)
+            {
+                erro = "snapshot corrompido (hardlinks)";
+                return false;
+            }
+            GrupoVinculo &grupo = vinculos_lidos[chave];
+            grupo.nos.push_back(registro.id);
+            if (!(nos_arquivo[registro.id].flags & FLAG_VINCULO_REPETIDO))
+            {
+                grupo.contado = registro.id;
+            }
+        }
+
+        nos.apontarPara(reinterpret_cast<const No *>(base + cab.pos_nos), cab.num_nos);
+        estatisticas_nos.apontarPara(reinterpret_cast<const EstatisticasNo *>(base + cab.pos_estatisticas), cab.num_nos);
+        filhos.apontarPara(reinterpret_cast<const uint32_t *>(base + cab.pos_filhos), cab.num_filhos);
+        nomes.apontarPara(base + cab.pos_nomes, cab.bytes_nomes);
+        metas.apontarPara(reinterpret_cast<const MetaPasta *>(base + cab.pos_metas), cab.num_metas);
+        caminho_raiz.assign(base + cab.pos_caminho_raiz, cab.bytes_caminho_raiz);
+        descartados = cab.descartados;
+        uso_disco = (cab.opcoes & OPCAO_SNAPSHOT_USO_DISCO) != 0;
+        vinculos = move(vinculos_lidos);
+        inode_vinculo = move(inode_lido);
+        mapeamento = move(mapa);
+        return true;
+    }
+
+    // Retorna o número de filhos diretos (não recursivo) de um nó
+    // @param id: Nó consultado
+    // @return O número total de nós filhos imediatos (arquivos e pastas)
+    // @note Este método conta apenas os filhos diretos, não incluindo subpastas
+    //       ou arquivos dentro das subpastas. Para uma contagem completa de
+    //       todos os itens na árvore, seria necessário um método recursivo.
+    // @see calcularTamanhoTotal() para um exemplo de método recursivo
+    int contarFilhos(uint32_t id) const
+    {
+        return nos[id].num_filhos;
+    }
+
+    // Calcula o tamanho total de um nó e seus descendentes recursivamente
+    // @param id: Nó consultado
+    // @return O tamanho total em bytes:
+    //         - Para arquivos: retorna o tamanho do próprio arquivo
+    //         - Para pastas: soma o tamanho de todos os arquivos contidos nela e suas subpastas
+    // @note O valor vem do cache de estatísticas (O(1)); a soma recursiva é feita uma
+    //       única vez por recalcularSubarvore() depois da carga
+    // @example Para uma pasta com estrutura:
+    //          /pasta (0 bytes)
+    //          ├── arquivo1.txt (100 bytes)
+    //          └── subpasta
+    //              └── arquivo2.txt (200 bytes)
+    //          O tamanho total será 300 bytes (100 + 200)
+    long calcularTamanhoTotal(uint32_t id) const
+    {
+        return estatisticas_nos[id].tamanho_total;
+    }
+
+    // Exibe a estrutura de arquivos e diretórios em formato de árvore no console
+    // @param id: Nó a partir do qual a árvore é exibida
+    // @param saida: Escritor que recebe o texto (stdout no menu), sem descarregar a cada linha
+    // @param opcoes: Profundidade máxima, filhos por pasta e ordenação (padrão: árvore inteira)
+    // @param nivel: Nível de profundidade do nó atual na árvore (0 para raiz)
+    // @param ultimo: Indica se é o último item em seu nível (true = └──, false = ├──)
+    // @note Este método usa caracteres especiais para criar a visualização hierárquica:
+    //       │   : Linha vertical para conectar níveis
+    //       ├── : Conexão para itens intermediários
+    //       └── : Conexão para o último item
+    //       Com max_filhos, só os N filhos de maior tamanho total aparecem e os demais
+    //       são resumidos em uma linha "(+k outros, X bytes)"; o custo por pasta é
+    //       O(filhos) para escolhê-los, sem percorrer as subárvores escondidas.
+    // @example Exemplo de saída (max_filhos = 2):
+    //          pasta (3 filhos, 350 bytes)
+    //          ├── arquivo.txt (100 bytes)
+    //          ├── subpasta (1 filho, 200 bytes)
+    //          |   └── outro.txt (200 bytes)
+    //          └── (+1 outros, 50 bytes)
+    void mostrar(uint32_t id, EscritorBuffer &saida, const OpcoesExibicao &opcoes = {}, int nivel = 0, bool ultimo = true) const
+    {
+        // Indentação inicial
+        if (nivel > 0)
+        {
+            escreverIndentacao(saida, nivel);
+            saida << (ultimo ? "└── " : "├── ");
+        }
+
+        // Nome e informações
+        saida << nome(id);
+        escreverResumo(id, saida);
+        saida << '\n';
+
+        if (opcoes.profundidade_max >= 0 && nivel >= opcoes.profundidade_max)
+        {
+            return;
+        }
+
+        // Mostra filhos com a linha vertical
+        IntervaloFilhos lista = filhosDe(id);
+        if (!opcoes.ordenar_por_tamanho && (opcoes.max_filhos == 0 || lista.size() <= opcoes.max_filhos))
+        {
+            for (size_t i = 0; i < lista.size(); i++)
+            {
+                mostrar(lista[i], saida, opcoes, nivel + 1, i == lista.size() - 1);
+            }
+            return;
+        }
+
+        // Escolhe os maiores (e/ou ordena): empates mantêm a ordem original. Os irmãos
+        // são tratados pela posição na lista de filhos, que depois de renomeações e
+        // recargas já não acompanha a ordem dos ids
+        vector<uint32_t> visiveis(lista.size()); // posições em "lista"
+        for (uint32_t i = 0; i < visiveis.size(); i++)
+        {
+            visiveis[i] = i;
+        }
+        auto maior = [&](uint32_t a, uint32_t b)
+        {
+            int64_t ta = estatisticas_nos[lista[a]].tamanho_total, tb = estatisticas_nos[lista[b]].tamanho_total;
+            return ta > tb || (ta == tb && a < b);
+        };
+        int64_t tamanho_ocultos = 0;
+        size_t ocultos = 0;
+        if (opcoes.max_filhos > 0 && visiveis.size() > opcoes.max_filhos)
+        {
+            nth_element(visiveis.begin(), visiveis.begin() + opcoes.max_filhos, visiveis.end(), maior);
+            for (size_t i = opcoes.max_filhos; i < visiveis.size(); i++)
+            {
+                tamanho_ocultos += estatisticas_nos[lista[visiveis[i]]].tamanho_total;
+            }
+            ocultos = visiveis.size() - opcoes.max_filhos;
+            visiveis.resize(opcoes.max_filhos);
+        }
+        if (opcoes.ordenar_por_tamanho)
+        {
+            sort(visiveis.begin(), visiveis.end(), maior);
+        }
+        else
+        {
+            sort(visiveis.begin(), visiveis.end());
+        }
+        for (size_t i = 0; i < visiveis.size(); i++)
+        {
+            mostrar(lista[visiveis[i]], saida, opcoes, nivel + 1, ocultos == 0 && i == visiveis.size() - 1);
+        }
+        if (ocultos > 0)
+        {
+            escreverIndentacao(saida, nivel + 1);
+            saida << "└── (+" << ocultos << " outros, " << tamanho_ocultos << " bytes)\n";
+        }
+    }
+
+    // Gera a representação HTML da árvore de arquivos e diretórios
+    // @param id: Nó a partir do qual a árvore é gerada
+    // @param saida: Escritor que recebe o HTML (gravado aos poucos, sem montar a página em memória)
+    // @param nivel: Nível de profundidade do nó atual na árvore (0 para raiz)
+    // @param ultimo: Indica se é o último item em seu nível (true para último item)
+    // @note Este método gera uma representação visual da árvore usando caracteres especiais:
+    //       │   : Linha vertical para conectar níveis
+    //       ├── : Conexão para itens intermediários
+    //       └── : Conexão para o último item
+    // @example Exemplo de saída HTML:
+    //          <span class='pasta'>documentos (2 filhos, 300 bytes)</span>
+    //          ├── <span class='arquivo'>relatorio.txt (100 bytes)</span>
+    //          └── <span class='pasta'>imagens (1 filho, 200 bytes)</span>
+    void gerarHTML(uint32_t id, EscritorBuffer &saida, int nivel = 0, bool ultimo = true) const
+    {
+        // Indentação inicial
+        for (int i = 0; i < nivel; i++)
+        {
+            saida << (i == nivel - 1 ? (ultimo ? "└── " : "├── ") : "│   ");
+        }
+
+        // Nome e informações
+        saida << "<span class='" << nomeTipo(nos[id].tipo) << "'>";
+        escreverHTML(saida, nome(id));
+        escreverResumo(id, saida);
+        saida << "</span><br>\n";
+
+        // Adiciona filhos
+        IntervaloFilhos lista = filhosDe(id);
+        for (size_t i = 0; i < lista.size(); i++)
+        {
+            gerarHTML(lista[i], saida, nivel + 1, i == lista.size() - 1);
+        }
+    }
+
+    // Gera o HTML recolhível da árvore: cada pasta vira uma seção <details>
+    // @param id: Nó a partir do qual a árvore é gerada
+    // @param saida: Escritor que recebe o HTML
+    // @param niveis_html: Quantos níveis são escritos como HTML; abaixo disso o
+    //                     conteúdo de cada pasta vai como JSON compacto em um bloco
+    //                     <script type='application/json'> que só é interpretado
+    //                     (e transformado em elementos) quando a seção é aberta
+    // @param nivel: Nível de profundidade do nó atual (0 para raiz)
+    void gerarHTMLRecolhivel(uint32_t id, EscritorBuffer &saida, int niveis_html, int nivel = 0) const
+    {
+        if (ehArquivo(id))
+        {
+            saida << "<div><span class='arquivo'>";
+            escreverHTML(saida, nome(id));
+            escreverResumo(id, saida);
+            saida << "</span></div>\n";
+            return;
+        }
+
+        bool adiado = nivel >= niveis_html && nos[id].num_filhos > 0;
+        saida << (adiado ? "<details class='adiado'>" : (nivel == 0 ? "<details open>" : "<details>"))
+              << "<summary><span class='pasta'>";
+        escreverHTML(saida, nome(id));
+        escreverResumo(id, saida);
+        saida << "</span></summary>\n";
+        if (adiado)
+        {
+            saida << "<script type='application/json'>";
+            gerarJSONFilhos(id, saida);
+            saida << "</script>";
+        }
+        else
+        {
+            for (uint32_t filho : filhosDe(id))
+            {
+                gerarHTMLRecolhivel(filho, saida, niveis_html, nivel + 1);
+            }
+        }
+        saida << "</details>\n";
+    }
+
+    // Escreve os filhos de uma pasta como JSON compacto (recursivo)
+    // @note Formato: arquivo = ["nome", tamanho];
+    //                pasta   = ["nome", tamanho_total, num_filhos, [filhos...]]
+    void gerarJSONFilhos(uint32_t id, EscritorBuffer &saida) const
+    {
+        saida << '[';
+        bool primeiro = true;
+        for (uint32_t filho : filhosDe(id))
+        {
+            saida << (primeiro ? "[" : ",[");
+            primeiro = false;
+            escreverJSON(saida, nome(filho));
+            saida << ',' << estatisticas_nos[filho].tamanho_total;
+            if (!ehArquivo(filho))
+            {
+                saida << ',' << nos[filho].num_filhos << ',';
+                gerarJSONFilhos(filho, saida);
+            }
+            saida << ']';
+        }
+        saida << ']';
+    }
+
+    // Parte de uma travessia dividida por percorrerEmParalelo
+    struct TarefaConsulta
+    {
+        uint32_t id;
+        bool so_o_no; // visita só o próprio nó (os filhos viraram tarefas separadas)
+    };
+
+    // Percorre a subárvore de "id" em pré-ordem, dividida em tarefas executadas em paralelo
+    // @param num_threads: Threads usadas (0 = uma por núcleo)
+    // @param visitar: Chamado como visitar(no, estado) para cada nó; dentro de uma
+    //        tarefa, os nós chegam em pré-ordem
+    // @return Um estado por tarefa, na ordem da pré-ordem: combinar os estados nessa
+    //         ordem dá exatamente o resultado da travessia serial (inclusive empates)
+    // @note As tarefas saem de sucessivas divisões da maior subárvore pendente (o
+    //       tamanho vem das estatísticas, sem percorrer nada): a pasta dividida vira
+    //       uma tarefa só dela seguida de uma tarefa por filho. As threads pegam a
+    //       próxima tarefa livre de um contador atômico e cada tarefa escreve só no
+    //       próprio estado, então não há trava nem vetor de saída compartilhado.
+    template <typename Estado, typename Visitar>
+    vector<Estado> percorrerEmParalelo(uint32_t id, unsigned num_threads, Visitar visitar) const
+    {
+        if (num_threads == 0)
+        {
+            num_threads = max(1u, thread::hardware_concurrency());
+        }
+        auto tamanhoSubarvore = [&](uint32_t no)
+        {
+            return 1 + static_cast<uint64_t>(estatisticas_nos[no].num_arquivos) + estatisticas_nos[no].num_pastas;
+        };
+        const uint64_t total = tamanhoSubarvore(id);
+        vector<TarefaConsulta> tarefas{{id, false}};
+        if (num_threads > 1 && total >= 65536)
+        {
+            // Divide até as tarefas ficarem pequenas (cerca de 8 por thread) ou numerosas demais
+            const uint64_t alvo = max<uint64_t>(total / (8ull * num_threads), 4096);
+            while (tarefas.size() < 32ull * num_threads)
+            {
+                size_t maior = tarefas.size();
+                for (size_t i = 0; i < tarefas.size(); i++)
+                {
+                    if (!tarefas[i].so_o_no && !ehArquivo(tarefas[i].id) &&
+                        (maior == tarefas.size() || tamanhoSubarvore(tarefas[i].id) > tamanhoSubarvore(tarefas[maior].id)))
+                    {
+                        maior = i;
+                    }
+                }
+                if (maior == tarefas.size() || tamanhoSubarvore(tarefas[maior].id) <= alvo)
+                {
+                    break;
+                }
+                uint32_t pasta = tarefas[maior].id;
+                tarefas[maior].so_o_no = true;
+                vector<TarefaConsulta> filhos;
+                for (uint32_t filho : filhosDe(pasta))
+                {
+                    filhos.push_back({filho, false});
+                }
+                tarefas.insert(tarefas.begin() + maior + 1, filhos.begin(), filhos.end());
+            }
+        }
+
+        vector<Estado> estados(tarefas.size());
+        atomic<size_t> proxima{0};
+        auto trabalhar = [&]
+        {
+            vector<uint32_t> pilha;
+            for (size_t t = proxima++; t < tarefas.size(); t = proxima++)
+            {
+                if (tarefas[t].so_o_no)
+                {
+                    visitar(tarefas[t].id, estados[t]);
+                    continue;
+                }
+                pilha.assign(1, tarefas[t].id);
+                while (!pilha.empty())
+                {
+                    uint32_t no = pilha.back();
+                    pilha.pop_back();
+                    visitar(no, estados[t]);
+                    IntervaloFilhos filhos = filhosDe(no);
+                    for (size_t i = filhos.size(); i > 0; i--)
+                    {
+                        pilha.push_back(filhos[i - 1]);
+                    }
+                }
+            }
+        };
+        vector<thread> grupo;
+        for (unsigned i = 1; i < min<size_t>(num_threads, tarefas.size()); i++)
+        {
+            grupo.emplace_back(trabalhar);
+        }
+        trabalhar();
+        for (auto &t : grupo)
+        {
+            t.join();
+        }
+        return estados;
+    }
+
+    // função recursiva que encontra o(s) arquivo(s) de maior tamanho na árvore de arquivos
+    // id: nó a partir do qual a busca é feita
+    // max_tam: referência para o maior tamanho encontrado até o momento
+    // caminhos: referência para um vetor que acumula os caminhos dos arquivos de maior tamanho
+    // num_threads: com valor diferente de 1, a busca usa percorrerEmParalelo (0 = um por núcleo)
+    // a função atualiza max_tam e caminhos conforme percorre a árvore
+    void encontraMaiorArquivo(uint32_t id, long &max_tam, vector<string> &caminhos, unsigned num_threads = 1) const
+    {
+        if (num_threads != 1)
+        {
+            struct Parcial
+            {
+                long max_tam = LONG_MIN;
+                vector<uint32_t> ids;
+            };
+            auto parciais = percorrerEmParalelo<Parcial>(id, num_threads, [&](uint32_t no, Parcial &p)
+                                                         {
+                if (!ehArquivo(no))
+                {
+                    return;
+                }
+                long tamanho = nos[no].tamanho;
+                if (tamanho > p.max_tam)
+                {
+                    p.max_tam = tamanho;
+                    p.ids.clear();
+                }
+                if (tamanho == p.max_tam)
+                {
+                    p.ids.push_back(no);
+                } });
+            // Na ordem das tarefas: um máximo maior substitui, um igual acumula (como na recursão)
+            for (const Parcial &p : parciais)
+            {
+                if (p.max_tam > max_tam)
+                {
+                    max_tam = p.max_tam;
+                    caminhos.clear();
+                }
+                if (p.max_tam == max_tam)
+                {
+                    for (uint32_t no : p.ids)
+                    {
+                        caminhos.push_back(caminho(no));
+                    }
+                }
+            }
+            return;
+        }
+        if (ehArquivo(id))
+        { // se o nó for arquivo
+            long tamanho = nos[id].tamanho;
+            if (tamanho > max_tam)
+            {                                  // e se for maior que o tamanho atual máximo
+                max_tam = tamanho;             // atualiza o maior tamanho
+                caminhos.clear();              // limpa os caminhos anteriores
+                caminhos.push_back(caminho(id)); // adiciona o novo maior
+            }
+            else if (tamanho == max_tam)
+            {
+                caminhos.push_back(caminho(id)); // se for do mesmo tamanho do maior, adiciona também
+            }
+        }
+        for (uint32_t filho : filhosDe(id))
+        { // aplica recursivamente para todos os filhos (arquivos e subpastas)
+            encontraMaiorArquivo(filho, max_tam, caminhos);
+        }
+    }
+    // Busca todos os arquivos com uma extensão específica usando o índice invertido
+    // ext: extensão procurada, sem diferenciar maiúsculas (ex: ".txt", "CPP").
+    // arquivos: vetor que armazena os caminhos completos dos arquivos encontrados
+    // o índice extensão -> ids é montado uma única vez na carga, então a consulta custa
+    //       proporcional ao número de resultados, sem percorrer a árvore.
+    //       Os resultados saem na ordem dos ids (pastas mais rasas primeiro).
+    void buscaPorExtensao(const string &ext, vector<string> &arquivos) const
+    {
+        for (uint32_t id : idsPorExtensao(ext))
+        {
+            arquivos.push_back(caminho(id)); // adiciona à lista de resultados
+        }
+    }
+
+    // Ids dos arquivos com uma extensão (sem diferenciar maiúsculas), em ordem crescente
+    vector<uint32_t> idsPorExtensao(const string &ext) const
+    {
+        garantirIndiceExtensoes();
+        string chave = normalizarExtensao(ext);
+        vector<uint32_t> ids;
+        auto lista = indice->por_extensao.find(chave);
+        if (lista == indice->por_extensao.end())
+        {
+            return ids;
+        }
+        for (uint32_t id : lista->second)
+        {
+            // descarta ids de arquivos removidos ou renomeados para outra extensão
+            if (ehArquivo(id) && normalizarExtensao(extensao(nome(id))) == chave)
+            {
+                ids.push_back(id);
+            }
+        }
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        return ids;
+    }
+
+    // Ids dos arquivos cujo nome começa com "prefixo", em ordem alfabética
+    // @note Busca binária sobre o índice de nomes ordenados: O(log n + resultados)
+    vector<uint32_t> idsPorPrefixo(string_view prefixo) const
+    {
+        garantirIndiceOrdenado();
+        const vector<uint32_t> &ordem = indice->por_nome;
+        auto inicio = lower_bound(ordem.begin(), ordem.end(), prefixo, [&](uint32_t id, string_view p)
+                                  { return nome(id).substr(0, p.size()) < p; });
+        auto fim = upper_bound(inicio, ordem.end(), prefixo, [&](string_view p, uint32_t id)
+                               { return p < nome(id).substr(0, p.size()); });
+        return vector<uint32_t>(inicio, fim);
+    }
+
+    // Ids dos arquivos cujo nome termina com "sufixo", ordenados pelo nome invertido
+    // @note Busca binária sobre o índice de nomes lidos de trás para frente
+    vector<uint32_t> idsPorSufixo(string_view sufixo) const
+    {
+        garantirIndiceOrdenado();
+        const vector<uint32_t> &ordem = indice->por_nome_invertido;
+        auto fimDe = [&](uint32_t id)
+        {
+            string_view n = nome(id);
+            return n.substr(n.size() - min(n.size(), sufixo.size()));
+        };
+        auto inicio = lower_bound(ordem.begin(), ordem.end(), sufixo, [&](uint32_t id, string_view s)
+                                  { return compararInvertido(fimDe(id), s) < 0; });
+        auto fim = upper_bound(inicio, ordem.end(), sufixo, [&](string_view s, uint32_t id)
+                               { return compararInvertido(s, fimDe(id)) < 0; });
+        return vector<uint32_t>(inicio, fim);
+    }
+
+    // Ids dos arquivos cujo nome casa com um padrão glob ou regex, em ordem crescente
+    // @note Varre o bloco contíguo de nomes procurando o trecho fixo do padrão com
+    //       procurarTrecho e converte cada ocorrência no arquivo dono daquela posição
+    //       (busca binária na ordem dos nomes no bloco); o glob ou a regex completa só
+    //       roda nesses candidatos. Ocorrências em nomes antigos (de arquivos renomeados
+    //       ou removidos) ou que cruzam a fronteira entre dois nomes são descartadas.
+    //       Sem trecho fixo (ex: "*"), testa o padrão em todos os nomes.
+    vector<uint32_t> idsPorPadrao(const PadraoNome &padrao) const
+    {
+        garantirIndicePosicoes();
+        const vector<uint32_t> &ordem = indice->por_posicao;
+        vector<uint32_t> ids;
+        const string &literal = padrao.literal;
+        if (literal.empty())
+        {
+            for (uint32_t id : ordem)
+            {
+                if (padrao.corresponde(nome(id)))
+                {
+                    ids.push_back(id);
+                }
+            }
+            return ids;
+        }
+        auto fimNome = [&](uint32_t id)
+        {
+            return static_cast<size_t>(nos[id].nome_inicio) + nos[id].nome_tamanho;
+        };
+        auto cursor = ordem.begin();
+        while (cursor != ordem.end())
+        {
+            size_t pos = procurarTrecho(nomes.data(), nomes.size(), nos[*cursor].nome_inicio, literal);
+            if (pos == string_view::npos)
+            {
+                break;
+            }
+            // Primeiro nome que termina depois da ocorrência
+            cursor = partition_point(cursor, ordem.end(), [&](uint32_t id)
+                                     { return fimNome(id) < pos + literal.size(); });
+            if (cursor == ordem.end())
+            {
+                break;
+            }
+            if (nos[*cursor].nome_inicio <= pos)
+            {
+                if (padrao.corresponde(nome(*cursor)))
+                {
+                    ids.push_back(*cursor);
+                }
+                ++cursor;
+            }
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // Os k maiores arquivos, do maior para o menor
+    // @return Pares <id, tamanho>; empates de tamanho saem em ordem crescente de id
+    vector<pair<uint32_t, int64_t>> maioresArquivos(size_t k) const
+    {
+        return arquivosEntre(0, INT64_MAX, k);
+    }
+
+    // Arquivos com tamanho entre "minimo" e "maximo" bytes (inclusive), do maior para o menor
+    // @param limite: Quantidade máxima de resultados
+    // @return Pares <id, tamanho>
+    // @note Busca binária no índice de tamanhos seguida de uma intercalação com as
+    //       alterações pendentes: O(log n + resultados), sem percorrer a árvore
+    vector<pair<uint32_t, int64_t>> arquivosEntre(int64_t minimo, int64_t maximo, size_t limite = SIZE_MAX) const
+    {
+        garantirIndiceTamanhos();
+        const IndiceTamanhos &idx = *indice_tamanhos;
+        OrdemTamanhoDecrescente ordem;
+        ChaveTamanho primeira{maximo, 0};
+        auto b = lower_bound(idx.base.begin(), idx.base.end(), primeira, ordem);
+        auto i = idx.inseridos.lower_bound(primeira);
+
+        vector<pair<uint32_t, int64_t>> resultado;
+        while (resultado.size() < limite)
+        {
+            while (b != idx.base.end() && idx.removidos.count(*b))
+            {
+                ++b;
+            }
+            bool tem_base = b != idx.base.end() && b->first >= minimo;
+            bool tem_inserido = i != idx.inseridos.end() && i->first >= minimo;
+            if (!tem_base && !tem_inserido)
+            {
+                break;
+            }
+            if (tem_base && (!tem_inserido || ordem(*b, *i)))
+            {
+                resultado.emplace_back(b->second, b->first);
+                ++b;
+            }
+            else
+            {
+                resultado.emplace_back(i->second, i->first);
+                ++i;
+            }
+        }
+        return resultado;
+    }
+
+    // Indica se os índices já foram montados (nas árvores abertas de snapshot eles
+    // só são montados quando alguma consulta precisa deles)
+    bool indiceTamanhosPronto() const
+    {
+        lock_guard<mutex> guarda(indice_tamanhos->trava);
+        return indice_tamanhos->pronto;
+    }
+    bool indiceExtensoesPronto() const
+    {
+        lock_guard<mutex> guarda(indice->trava);
+        return indice->extensoes_prontas;
+    }
+
+    // Monta o índice de tamanhos (chamado ao final da carga; nas árvores abertas de
+    // snapshot, na primeira consulta)
+    void garantirIndiceTamanhos() const
+    {
+        lock_guard<mutex> guarda(indice_tamanhos->trava);
+        if (indice_tamanhos->pronto)
+        {
+            return;
+        }
+        vector<ChaveTamanho> &base = indice_tamanhos->base;
+        base.clear();
+        for (uint32_t id = 0; id < nos.size(); id++)
+        {
+            if (ehArquivo(id))
+            {
+                base.emplace_back(nos[id].tamanho, id);
+            }
+        }
+        sort(base.begin(), base.end(), OrdemTamanhoDecrescente());
+        indice_tamanhos->inseridos.clear();
+        indice_tamanhos->removidos.clear();
+        indice_tamanhos->pronto = true;
+    }
+
+    // Monta o índice de extensões (chamado ao final da carga; nas árvores abertas de
+    // snapshot, na primeira consulta)
+    void garantirIndiceExtensoes() const
+    {
+        lock_guard<mutex> guarda(indice->trava);
+        if (indice->extensoes_prontas)
+        {
+            return;
+        }
+        indice->por_extensao.clear();
+        indice->extensoes_prontas = true;
+        for (uint32_t id = 0; id < nos.size(); id++)
+        {
+            if (ehArquivo(id))
+            {
+                indexarArquivo(id);
+            }
+        }
+    }
+
+    // função recursiva que encontra todas as pastas vazias na árvore de arquivos
+    // id: nó a partir do qual a busca é feita
+    // vazias: vetor que armazena os caminhos completos das pastas sem nenhum filho
+    // num_threads: com valor diferente de 1, a busca usa percorrerEmParalelo (0 = um por núcleo)
+    // uma pasta é considerada vazia se não possui nem arquivos nem subpastas diretamente dentro dela
+    void encontraPastasVazias(uint32_t id, vector<string> &vazias, unsigned num_threads = 1) const
+    {
+        if (num_threads != 1)
+        {
+            auto parciais = percorrerEmParalelo<vector<string>>(id, num_threads, [&](uint32_t no, vector<string> &p)
+                                                                {
+                if (!ehArquivo(no) && nos[no].num_filhos == 0)
+                {
+                    p.push_back(caminho(no));
+                } });
+            for (vector<string> &p : parciais)
+            {
+                move(p.begin(), p.end(), back_inserter(vazias));
+            }
+            return;
+        }
+        if (!ehArquivo(id))
+        { // se for pasta
+            if (nos[id].num_filhos == 0)
+            {
+                vazias.push_back(caminho(id)); // se não tiver filhos, é vazia
+            }
+            else
+            {
+                for (uint32_t filho : filhosDe(id))
+                { // senão, verifica recursivamente os filhos
+                    encontraPastasVazias(filho, vazias);
+                }
+            }
+        }
+    }
+    // Função recursiva que encontra todos os arquivos cujo tamanho é maior que N bytes.
+    // Os arquivos encontrados são adicionados ao vetor 'arquivos' como pares <caminho, tamanho>.
+    // Com num_threads diferente de 1, a busca usa percorrerEmParalelo (0 = um por núcleo).
+    void buscaArquivosMaiores(uint32_t id, long n, vector<pair<string, long>> &arquivos, unsigned num_threads = 1) const
+    {
+        if (num_threads != 1)
+        {
+            auto parciais = percorrerEmParalelo<vector<pair<string, long>>>(id, num_threads, [&](uint32_t no, vector<pair<string, long>> &p)
+                                                                            {
+                if (ehArquivo(no) && nos[no].tamanho > n)
+                {
+                    p.push_back({caminho(no), nos[no].tamanho});
+                } });
+            for (auto &p : parciais)
+            {
+                move(p.begin(), p.end(), back_inserter(arquivos));
+            }
+            return;
+        }
+        // Verifica se o nó é um arquivo e se seu tamanho é maior que n
+        if (ehArquivo(id) && nos[id].tamanho > n)
+        {
+            // Se a condição for satisfeita, adiciona o caminho completo e o tamanho ao vetor de resultados.
+            arquivos.push_back({caminho(id), nos[id].tamanho});
+        }
+
+        // Itera por todos os filhos do nó atual (caso seja uma pasta) e aplica a função recursivamente.
+        for (uint32_t filho : filhosDe(id))
+        {
+            buscaArquivosMaiores(filho, n, arquivos);
+        }
+    }
+    // Função recursiva que encontra a pasta com o maior número de arquivos diretamente dentro dela (não recursivo).
+    // Com num_threads diferente de 1, a busca usa percorrerEmParalelo (0 = um por núcleo).
+    void encontraPastaComMaisArquivos(uint32_t id, int &max_arquivos, string &caminho_pasta, unsigned num_threads = 1) const
+    {
+        if (num_threads != 1)
+        {
+            struct Parcial
+            {
+                int max_arquivos = -1;
+                uint32_t pasta = SEM_PAI;
+            };
+            auto parciais = percorrerEmParalelo<Parcial>(id, num_threads, [&](uint32_t no, Parcial &p)
+                                                         {
+                if (ehArquivo(no))
+                {
+                    return;
+                }
+                int arquivos_diretos = 0;
+                for (uint32_t filho : filhosDe(no))
+                {
+                    arquivos_diretos += ehArquivo(filho) ? 1 : 0;
+                }
+                if (arquivos_diretos > p.max_arquivos)
+                {
+                    p.max_arquivos = arquivos_diretos;
+                    p.pasta = no;
+                } });
+            // Desempate como na recursão: vence a primeira pasta da pré-ordem
+            for (const Parcial &p : parciais)
+            {
+                if (p.pasta != SEM_PAI && p.max_arquivos > max_arquivos)
+                {
+                    max_arquivos = p.max_arquivos;
+                    caminho_pasta = caminho(p.pasta);
+                }
+            }
+            return;
+        }
+        // Verifica se o nó atual é uma pasta.
+        if (!ehArquivo(id))
+        {
+            int arquivos_diretos = 0; // Contador para arquivos diretamente nesta pasta.
+            // Itera sobre os filhos imediatos do nó atual.
+            for (uint32_t filho : filhosDe(id))
+            {
+                // Se o filho for um arquivo, incrementa o contador.
+                if (ehArquivo(filho))
+                {
+                    arquivos_diretos++;
+                }
+            }
+            // Se a quantidade de arquivos diretos nesta pasta for maior do que a máxima encontrada até agora, atualiza os valores de referência.
+            if (arquivos_diretos > max_arquivos)
+            {
+                max_arquivos = arquivos_diretos;
+                caminho_pasta = caminho(id);
+            }
+            // Chama recursivamente a função para os filhos (subpastas) do nó atual.
+            for (uint32_t filho : filhosDe(id))
+            {
+                encontraPastaComMaisArquivos(filho, max_arquivos, caminho_pasta);
+            }
+        }
+    }
+
+private:
+    // Compara duas strings lidas de trás para frente (como strcmp: <0, 0 ou >0)
+    static int compararInvertido(string_view a, string_view b)
+    {
+        size_t i = a.size(), j = b.size();
+        while (i > 0 && j > 0)
+        {
+            unsigned char ca = a[--i], cb = b[--j];
+            if (ca != cb)
+            {
+                return ca < cb ? -1 : 1;
+            }
+        }
+        return (i > 0) - (j > 0);
+    }
+
+    // Acrescenta um arquivo à lista da sua extensão (se o índice já existir)
+    void indexarArquivo(uint32_t id) const
+    {
+        if (indice->extensoes_prontas)
+        {
+            indice->por_extensao[normalizarExtensao(extensao(nome(id)))].push_back(id);
+        }
+    }
+
+    // Registra no índice de tamanhos a entrada ou a saída de um arquivo (se o índice já existir)
+    // @param tamanho: Tamanho do arquivo no momento da alteração
+    // @param id: Arquivo
+    // @param entrada: true para acrescentar, false para retirar
+    void indexarTamanho(int64_t tamanho, uint32_t id, bool entrada)
+    {
+        IndiceTamanhos &idx = *indice_tamanhos;
+        if (!idx.pronto)
+        {
+            return;
+        }
+        ChaveTamanho chave{tamanho, id};
+        auto &mesmo_lado = entrada ? idx.inseridos : idx.removidos;
+        auto &outro_lado = entrada ? idx.removidos : idx.inseridos;
+        if (!outro_lado.erase(chave))
+        {
+            mesmo_lado.insert(chave);
+        }
+
+        // Incorpora as alterações à base quando elas passam de 1/16 do índice
+        if (idx.inseridos.size() + idx.removidos.size() > max<size_t>(4096, idx.base.size() / 16))
+        {
+            vector<ChaveTamanho> nova;
+            nova.reserve(idx.base.size() + idx.inseridos.size());
+            OrdemTamanhoDecrescente ordem;
+            auto i = idx.inseridos.begin();
+            for (const ChaveTamanho &chave_base : idx.base)
+            {
+                if (idx.removidos.count(chave_base))
+                {
+                    continue;
+                }
+                for (; i != idx.inseridos.end() && ordem(*i, chave_base); ++i)
+                {
+                    nova.push_back(*i);
+                }
+                nova.push_back(chave_base);
+            }
+            nova.insert(nova.end(), i, idx.inseridos.end());
+            idx.base = move(nova);
+            idx.inseridos.clear();
+            idx.removidos.clear();
+        }
+    }
+
+    // Monta (ou remonta, se a árvore mudou) os vetores de arquivos ordenados por nome
+    void garantirIndiceOrdenado() const
+    {
+        lock_guard<mutex> guarda(indice->trava);
+        if (indice->ordenados_prontos)
+        {
+            return;
+        }
+        vector<uint32_t> &por_nome = indice->por_nome;
+        por_nome.clear();
+        for (uint32_t id = 0; id < nos.size(); id++)
+        {
+            if (ehArquivo(id))
+            {
+                por_nome.push_back(id);
+            }
+        }
+        indice->por_nome_invertido = por_nome;
+        sort(por_nome.begin(), por_nome.end(), [&](uint32_t a, uint32_t b)
+             { return nome(a) < nome(b); });
+        sort(indice->por_nome_invertido.begin(), indice->por_nome_invertido.end(), [&](uint32_t a, uint32_t b)
+             { return compararInvertido(nome(a), nome(b)) < 0; });
+        indice->ordenados_prontos = true;
+    }
+
+    // Monta (ou remonta, se a árvore mudou) a lista de arquivos na ordem do bloco de nomes
+    // @note Os nomes são acrescentados ao bloco na ordem dos ids, então a lista
+    //       normalmente já sai ordenada; só nomes trocados por renomeação a desarrumam.
+    void garantirIndicePosicoes() const
+    {
+        lock_guard<mutex> guarda(indice->trava);
+        if (indice->posicoes_prontas)
+        {
+            return;
+        }
+        vector<uint32_t> &por_posicao = indice->por_posicao;
+        por_posicao.clear();
+        for (uint32_t id = 0; id < nos.size(); id++)
+        {
+            if (ehArquivo(id))
+            {
+                por_posicao.push_back(id);
+            }
+        }
+        auto antes = [&](uint32_t a, uint32_t b)
+        { return nos[a].nome_inicio < nos[b].nome_inicio; };
+        if (!is_sorted(por_posicao.begin(), por_posicao.end(), antes))
+        {
+            sort(por_posicao.begin(), por_posicao.end(), antes);
+        }
+        indice->posicoes_prontas = true;
+    }
+
+    // Escreve a indentação de uma linha de texto do nível "nivel" (sem o conector)
+    static void escreverIndentacao(EscritorBuffer &saida, int nivel)
+    {
+        for (int i = 0; i < nivel - 1; i++)
+        {
+            saida << "|   ";
+        }
+    }
+
+    // Escreve o resumo " (X bytes)" de um arquivo ou " (N filhos, X bytes)" de uma pasta
+    void escreverResumo(uint32_t id, EscritorBuffer &saida) const
+    {
+        if (ehArquivo(id))
+        {
+            saida << " (" << nos[id].tamanho << " bytes)";
+        }
+        else
+        {
+            int num_filhos = contarFilhos(id);
+            saida << " (" << num_filhos << (num_filhos == 1 ? " filho" : " filhos") << ", "
+                  << calcularTamanhoTotal(id) << " bytes)";
+        }
+    }
+
+    // Recalcula as estatísticas de um nó a partir das dos seus filhos diretos
+    void agregarFilhos(uint32_t id)
+    {
+        EstatisticasNo &est = estatisticas_nos[id];
+        if (ehArquivo(id))
+        {
+            est = {(nos[id].flags & FLAG_VINCULO_REPETIDO) ? 0 : nos[id].tamanho, 0, 0, 0, hashProprio(id)};
+            return;
+        }
+        est = {0, 0, 0, 0, hashProprio(id)};
+        for (uint32_t filho : filhosDe(id))
+        {
+            const EstatisticasNo &sub = estatisticas_nos[filho];
+            est.tamanho_total += sub.tamanho_total;
+            est.num_arquivos += sub.num_arquivos + (ehArquivo(filho) ? 1 : 0);
+            est.num_pastas += sub.num_pastas + (ehArquivo(filho) ? 0 : 1);
+            est.profundidade_max = max(est.profundidade_max, sub.profundidade_max + 1);
+            est.hash += misturarHash(sub.hash);
+        }
+    }
+
+    // Parte do hash Merkle que vem do próprio nó: nome e tipo, mais o tamanho nos arquivos
+    // @note O hash de uma pasta é hashProprio + a soma de misturarHash(hash do filho)
+    //       sobre os filhos. A soma não depende da ordem dos filhos (listagens em
+    //       ordens diferentes dão o mesmo hash) e deixa trocar a parcela de um filho
+    //       sem somar os outros de novo; o misturarHash de cada nível impede que mover
+    //       um item entre pastas irmãs se cancele na soma do avô.
+    uint64_t hashProprio(uint32_t id) const
+    {
+        uint64_t h = misturarHash(hashNome(nome(id)) + static_cast<uint64_t>(nos[id].tipo));
+        if (ehArquivo(id))
+        {
+            h += misturarHash(static_cast<uint64_t>(nos[id].tamanho) ^ 0x9E3779B97F4A7C15ull);
+        }
+        return h;
+    }
+
+    // Troca a parcela de um filho no hash de uma pasta (0 = filho ausente) e refaz os
+    // hashes dos ancestrais, um nível por vez: O(profundidade)
+    void trocarParcelaHash(uint32_t pai, uint64_t parcela_antiga, uint64_t parcela_nova)
+    {
+        for (uint32_t atual = pai; atual != SEM_PAI && parcela_antiga != parcela_nova; atual = nos[atual].pai)
+        {
+            uint64_t antes = estatisticas_nos[atual].hash;
+            estatisticas_nos[atual].hash += parcela_nova - parcela_antiga;
+            parcela_antiga = misturarHash(antes);
+            parcela_nova = misturarHash(estatisticas_nos[atual].hash);
+        }
+    }
+
+    // Soma diferenças de tamanho e de contagens a um nó e a todos os seus ancestrais
+    void aplicarDelta(uint32_t id, int64_t tamanho, int64_t arquivos, int64_t pastas)
+    {
+        for (uint32_t atual = id; atual != SEM_PAI; atual = nos[atual].pai)
+        {
+            EstatisticasNo &est = estatisticas_nos[atual];
+            est.tamanho_total += tamanho;
+            est.num_arquivos = static_cast<uint32_t>(est.num_arquivos + arquivos);
+            est.num_pastas = static_cast<uint32_t>(est.num_pastas + pastas);
+        }
+    }
+
+    // Recalcula a profundidade máxima de um nó pelos filhos diretos e sobe pelos
+    // ancestrais enquanto o valor continuar mudando
+    void corrigirProfundidade(uint32_t id)
+    {
+        for (uint32_t atual = id; atual != SEM_PAI; atual = nos[atual].pai)
+        {
+            uint32_t profundidade = 0;
+            for (uint32_t filho : filhosDe(atual))
+            {
+                profundidade = max(profundidade, estatisticas_nos[filho].profundidade_max + 1);
+            }
+            if (profundidade == estatisticas_nos[atual].profundidade_max)
+            {
+                break;
+            }
+            estatisticas_nos[atual].profundidade_max = profundidade;
+        }
+    }
+
+    // Acrescenta um id ao fim da lista de filhos de uma pasta. Se a lista não for a
+    // última do vetor "filhos", ela é copiada para o final antes (o espaço antigo
+    // fica sem uso); acréscimos seguidos na mesma pasta não copiam de novo.
+    void anexarNaLista(uint32_t pai, uint32_t filho)
+    {
+        reservarDeslocamentos(0, size_t(nos[pai].num_filhos) + 1);
+        No &p = nos[pai];
+        if (size_t(p.filhos_inicio) + p.num_filhos != filhos.size())
+        {
+            filhos_sem_uso += p.num_filhos;
+            uint32_t novo_inicio = static_cast<uint32_t>(filhos.size());
+            for (uint32_t i = 0; i < p.num_filhos; i++)
+            {
+                uint32_t copia = filhos[p.filhos_inicio + i];
+                filhos.push_back(copia);
+            }
+            p.filhos_inicio = novo_inicio;
+        }
+        filhos.push_back(filho);
+        p.num_filhos++;
+    }
+
+    // Retira um nó da lista de filhos do pai e desconta a sua subárvore dos ancestrais
+    void desligar(uint32_t id)
+    {
+        No &p = nos[nos[id].pai];
+        for (uint32_t i = 0; i < p.num_filhos; i++)
+        {
+            if (filhos[p.filhos_inicio + i] == id)
+            {
+                for (uint32_t j = i + 1; j < p.num_filhos; j++)
+                {
+                    filhos[p.filhos_inicio + j - 1] = filhos[p.filhos_inicio + j];
+                }
+                p.num_filhos--;
+                filhos_sem_uso++;
+                break;
+            }
+        }
+        const EstatisticasNo &est = estatisticas_nos[id];
+        bool arquivo = ehArquivo(id);
+        aplicarDelta(nos[id].pai, -est.tamanho_total, -int64_t(est.num_arquivos) - (arquivo ? 1 : 0),
+                     -int64_t(est.num_pastas) - (arquivo ? 0 : 1));
+        trocarParcelaHash(nos[id].pai, misturarHash(est.hash), 0);
+    }
+
+    // Marca todos os descendentes de um nó como Removido e esvazia a sua lista de filhos
+    void descartarDescendentes(uint32_t id)
+    {
+        vector<uint32_t> pilha(filhosDe(id).begin(), filhosDe(id).end());
+        while (!pilha.empty())
+        {
+            uint32_t atual = pilha.back();
+            pilha.pop_back();
+            for (uint32_t filho : filhosDe(atual))
+            {
+                pilha.push_back(filho);
+            }
+            if (ehArquivo(atual))
+            {
+                indexarTamanho(nos[atual].tamanho, atual, false);
+                esquecerVinculo(atual);
+            }
+            nos[atual].tipo = TipoNo::Removido;
+            nomes_sem_uso += nos[atual].nome_tamanho;
+            filhos_sem_uso += nos[atual].num_filhos;
+            nos[atual].num_filhos = 0;
+            descartados++;
+        }
+        filhos_sem_uso += nos[id].num_filhos;
+        nos[id].num_filhos = 0;
+    }
+
+    // Liga ou desliga FLAG_VINCULO_REPETIDO (construção, antes de recalcularSubarvore)
+    void definirVinculoRepetido(uint32_t id, bool repetido)
+    {
+        nos[id].flags = repetido ? (nos[id].flags | FLAG_VINCULO_REPETIDO) : (nos[id].flags & ~FLAG_VINCULO_REPETIDO);
+    }
+
+    // Tira do registro de hardlinks um arquivo que está saindo da árvore; se ele era
+    // o nó contado do inode, o inode fica à espera de promoverVinculos
+    void esquecerVinculo(uint32_t id)
+    {
+        auto no_vinculo = inode_vinculo.find(id);
+        if (no_vinculo == inode_vinculo.end())
+        {
+            return;
+        }
+        auto grupo = vinculos.find(no_vinculo->second);
+        vector<uint32_t> &membros = grupo->second.nos;
+        membros.erase(find(membros.begin(), membros.end(), id));
+        if (grupo->second.contado == id)
+        {
+            grupo->second.contado = SEM_PAI;
+            sem_contado.push_back(no_vinculo->second);
+        }
+        if (membros.empty())
+        {
+            vinculos.erase(grupo); // nenhum outro hardlink do inode na árvore
+        }
+        inode_vinculo.erase(no_vinculo);
+    }
+
+    // Passa a contar, para cada inode que perdeu o nó contado, o hardlink restante de
+    // menor id (o primeiro em largura, como na carga): ele perde FLAG_VINCULO_REPETIDO
+    // e o seu tamanho é somado aos ancestrais
+    // @note Chamado depois que toda a subárvore removida foi marcada, para que o nó
+    //       escolhido nunca seja um dos que estão saindo
+    void promoverVinculos()
+    {
+        for (const auto &chave : sem_contado)
+        {
+            auto grupo = vinculos.find(chave);
+            if (grupo == vinculos.end() || grupo->second.contado != SEM_PAI)
+            {
+                continue;
+            }
+            uint32_t novo = *min_element(grupo->second.nos.begin(), grupo->second.nos.end());
+            grupo->second.contado = novo;
+            definirVinculoRepetido(novo, false);
+            estatisticas_nos[novo].tamanho_total = nos[novo].tamanho;
+            aplicarDelta(nos[novo].pai, nos[novo].tamanho, 0, 0);
+            vinculos_promovidos++;
+        }
+        sem_contado.clear();
+    }
+
+    // Garante que os deslocamentos de 32 bits (No::nome_inicio e No::filhos_inicio)
+    // comportam mais "bytes_nomes" no bloco de nomes e "itens_filhos" no vetor de filhos
+    // @note Nomes trocados por mover, nomes de nós removidos e listas de filhos
+    //       realocadas ou esvaziadas continuam ocupando os vetores. Quando esse espaço
+    //       passa de metade do vetor (e de LIMIAR_COMPACTACAO), ou quando o acréscimo
+    //       estouraria 32 bits, os vetores são compactados. Se nem assim couber, o
+    //       acréscimo falha com length_error, como nos contêineres da biblioteca padrão.
+    void reservarDeslocamentos(size_t bytes_nomes, size_t itens_filhos)
+    {
+        bool estoura = nomes.size() + bytes_nomes > UINT32_MAX || filhos.size() + itens_filhos > UINT32_MAX;
+        bool nomes_ociosos = nomes_sem_uso > LIMIAR_COMPACTACAO && nomes_sem_uso > nomes.size() / 2;
+        bool filhos_ociosos = filhos_sem_uso > LIMIAR_COMPACTACAO && filhos_sem_uso > filhos.size() / 2;
+        if (!estoura && !nomes_ociosos && !filhos_ociosos)
+        {
+            return;
+        }
+        compactar();
+        if (nomes.size() + bytes_nomes > UINT32_MAX || filhos.size() + itens_filhos > UINT32_MAX)
+        {
+            throw length_error("arvore excede os deslocamentos de 32 bits dos nomes ou das listas de filhos");
+        }
+    }
+
+    // Reescreve o bloco de nomes e o vetor de filhos só com o que os nós vivos usam,
+    // na ordem dos ids (os nós removidos ficam sem nome e sem lista). Os ids não mudam;
+    // só a ordem dos nomes no bloco, então o índice por posição é refeito depois.
+    void compactar()
+    {
+        vector<char> novos_nomes;
+        vector<uint32_t> novos_filhos;
+        novos_nomes.reserve(nomes.size() - min(nomes.size(), nomes_sem_uso));
+        novos_filhos.reserve(filhos.size() - min(filhos.size(), filhos_sem_uso));
+        for (uint32_t id = 0; id < nos.size(); id++)
+        {
+            No &atual = nos[id];
+            if (atual.tipo == TipoNo::Removido)
+            {
+                atual.nome_inicio = 0;
+                atual.nome_tamanho = 0;
+            }
+            else
+            {
+                const char *inicio = nomes.data() + atual.nome_inicio;
+                atual.nome_inicio = static_cast<uint32_t>(novos_nomes.size());
+                novos_nomes.insert(novos_nomes.end(), inicio, inicio + atual.nome_tamanho);
+            }
+            const uint32_t *lista = filhos.data() + atual.filhos_inicio;
+            atual.filhos_inicio = static_cast<uint32_t>(novos_filhos.size());
+            novos_filhos.insert(novos_filhos.end(), lista, lista + atual.num_filhos);
+        }
+        nomes.substituir(move(novos_nomes));
+        filhos.substituir(move(novos_filhos));
+        nomes_sem_uso = 0;
+        filhos_sem_uso = 0;
+        indice->posicoes_prontas = false;
+    }
+
+    VetorMapeado<No> nos;           // todos os nós; o id de um nó é sua posição aqui
+    VetorMapeado<uint32_t> filhos;  // listas de filhos concatenadas (cada pasta aponta para um intervalo)
+    VetorMapeado<char> nomes;       // nomes concatenados, sem separadores
+    string caminho_raiz;            // caminho completo da raiz
+    VetorMapeado<EstatisticasNo> estatisticas_nos; // cache de estatísticas, indexado pelo id do nó
+    VetorMapeado<MetaPasta> metas;  // identidade e datas das pastas (indexado por No::meta)
+    size_t descartados = 0;
+    size_t nomes_sem_uso = 0;       // bytes de "nomes" que nenhum nó vivo usa mais
+    size_t filhos_sem_uso = 0;      // itens de "filhos" fora das listas atuais
+    static constexpr size_t LIMIAR_COMPACTACAO = 1 << 20;
+    bool uso_disco = false;         // tamanhos em blocos alocados e hardlinks contados uma vez
+    // Nós de um inode com hardlinks: o contado nos totais e os repetidos
+    struct GrupoVinculo
+    {
+        uint32_t contado = SEM_PAI;
+        vector<uint32_t> nos;
+    };
+    map<pair<uint64_t, uint64_t>, GrupoVinculo> vinculos;            // (dispositivo, inode) -> nós
+    unordered_map<uint32_t, pair<uint64_t, uint64_t>> inode_vinculo; // nó -> (dispositivo, inode)
+    vector<pair<uint64_t, uint64_t>> sem_contado; // inodes cujo nó contado acabou de sair da árvore
+    uint64_t vinculos_promovidos = 0;
+    shared_ptr<MapeamentoArquivo> mapeamento; // snapshot de onde os vetores foram abertos (se houver)
+    unique_ptr<IndiceNomes> indice;           // índices de nomes (extensão, prefixo, sufixo)
+    unique_ptr<IndiceTamanhos> indice_tamanhos; // arquivos ordenados por tamanho
+};
+
+// Função que exporta a árvore de arquivos para um arquivo HTML
+// @param arvore: Árvore de arquivos a ser exportada a partir da raiz
+// @param arquivo_saida: Caminho do arquivo HTML de saída
+// @param recolhivel: false gera a árvore completa com linhas (formato original);
+//                    true gera seções <details> que carregam os níveis profundos sob demanda
+// @param niveis_html: No modo recolhível, quantos níveis são escritos direto como HTML
+// @return true se o arquivo foi criado e gravado por completo
+// @note Esta função cria um documento HTML completo com:
+//       - Codificação UTF-8 para suporte a caracteres especiais
+//       - Estilos CSS para formatação visual (cores e fontes)
+//       - Estrutura hierárquica mantida através de indentação
+//       O documento é gravado em fluxo por um EscritorBuffer, então a memória usada
+//       não depende do tamanho da árvore.
+// @example O arquivo HTML gerado terá:
+//          - Arquivos em preto
+//          - Diretórios em verde
+//          - Fonte monoespaçada para alinhamento
+bool exportarHTML(const ArvoreArquivos &arvore, const string &arquivo_saida, bool recolhivel = false, int niveis_html = 3)
+{
+    FILE *arquivo = fopen(arquivo_saida.c_str(), "wb");
+    if (arquivo == nullptr)
+    {
+        return false;
+    }
+
+    bool falhou;
+    {
+        EscritorBuffer saida(arquivo, 4 << 20);
+        saida << "<!DOCTYPE html>\n"
+              << "<html>\n<head>\n"
+              << "    <meta charset='UTF-8'>\n"
+              << "    <title>Árvore de Arquivos</title>\n"
+              << "    <style>\n"
+              << "        body { \n"
+              << "            font-family: monospace;\n"
+              << (recolhivel ? "" : "            white-space: pre;\n")
+              << "            margin: 20px;\n"
+              << "        }\n"
+              << "        .arquivo { color: black; }\n"
+              << "        .pasta { color: green; }\n";
+        if (recolhivel)
+        {
+            saida << "        details details, details div { margin-left: 1.5em; }\n"
+                  << "        div { white-space: pre; }\n";
+        }
+        saida << "    </style>\n"
+              << "</head>\n<body>\n";
+
+        if (recolhivel)
+        {
+            arvore.gerarHTMLRecolhivel(arvore.raiz(), saida, niveis_html);
+            // Expande sob demanda as pastas cujo conteúdo foi gravado como JSON
+            saida << "<script>\n"
+                  << "function criarItem(e) {\n"
+                  << "    const span = document.createElement('span');\n"
+                  << "    if (e.length === 2) {\n"
+                  << "        span.className = 'arquivo';\n"
+                  << "        span.textContent = e[0] + ' (' + e[1] + ' bytes)';\n"
+                  << "        const div = document.createElement('div');\n"
+                  << "        div.appendChild(span);\n"
+                  << "        return div;\n"
+                  << "    }\n"
+                  << "    span.className = 'pasta';\n"
+                  << "    span.textContent = e[0] + ' (' + e[2] + (e[2] === 1 ? ' filho' : ' filhos') + ', ' + e[1] + ' bytes)';\n"
+                  << "    const resumo = document.createElement('summary');\n"
+                  << "    resumo.appendChild(span);\n"
+                  << "    const secao = document.createElement('details');\n"
+                  << "    secao.appendChild(resumo);\n"
+                  << "    secao.filhosPendentes = e[3];\n"
+                  << "    secao.addEventListener('toggle', expandir);\n"
+                  << "    return secao;\n"
+                  << "}\n"
+                  << "function expandir(evento) {\n"
+                  << "    const secao = evento.target;\n"
+                  << "    if (!secao.open) return;\n"
+                  << "    let filhos = secao.filhosPendentes;\n"
+                  << "    if (filhos === undefined) {\n"
+                  << "        const dados = secao.querySelector(':scope > script');\n"
+                  << "        if (!dados) return;\n"
+                  << "        filhos = JSON.parse(dados.textContent);\n"
+                  << "        dados.remove();\n"
+                  << "    }\n"
+                  << "    if (filhos === null) return;\n"
+                  << "    secao.filhosPendentes = null;\n"
+                  << "    const fragmento = document.createDocumentFragment();\n"
+                  << "    for (const filho of filhos) fragmento.appendChild(criarItem(filho));\n"
+                  << "    secao.appendChild(fragmento);\n"
+                  << "}\n"
+                  << "document.querySelectorAll('details.adiado').forEach(s => s.addEventListener('toggle', expandir));\n"
+                  << "</script>\n";
+        }
+        else
+        {
+            arvore.gerarHTML(arvore.raiz(), saida, 0, true);
+        }
+        saida << "</body>\n</html>";
+        saida.descarregar();
+        falhou = saida.falhou();
+    }
+
+    return fclose(arquivo) == 0 && !falhou;
+}
+
+// Pico de memória residente do processo até agora, em KB
+static long picoMemoriaKB()
+{
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+#ifdef __APPLE__
+    return uso.ru_maxrss / 1024; // macOS informa em bytes
+#else
+    return uso.ru_maxrss;
+#endif
+}
+
+// Contadores e tempos da execução, usados pela linha de progresso e pelo relatório --stats
+// @note Os workers da varredura acumulam os contadores de cada pasta em variáveis
+//       locais e somam aqui uma vez por pasta, para não disputarem a mesma linha de
+//       cache a cada chamada de sistema. Fases e consultas com o mesmo nome (recargas,
+//       pastas novas vistas pelo monitor) são somadas em uma única entrada.
+struct Instrumentacao
+{
+    struct Medida
+    {
+        string nome;
+        double ms;
+        uint64_t itens; // entradas processadas (fases) ou resultados (consultas)
+        uint64_t vezes;
+    };
+
+    atomic<uint64_t> pastas_listadas{0};
+    atomic<uint64_t> entradas_lidas{0};
+    atomic<uint64_t> aberturas{0};          // openat de pastas
+    atomic<uint64_t> leituras_diretorio{0}; // getdents64 (com readdir, uma por pasta)
+    atomic<uint64_t> stats{0};              // fstat, fstatat e lstat
+    atomic<uint64_t> erros{0};              // aberturas, leituras e stats que falharam
+    atomic<uint64_t> roubos{0};             // tarefas tomadas da fila de outro worker
+    atomic<uint64_t> bytes_listagens{0};    // memória das listagens temporárias da varredura
+    atomic<bool> progresso{false};          // exibe a linha de progresso durante a varredura
+
+    // Soma a duração de uma fase (desde "inicio") à entrada de mesmo nome
+    void registrarFase(const string &nome, chrono::steady_clock::time_point inicio, uint64_t itens)
+    {
+        registrar(fases, nome, inicio, itens);
+    }
+
+    // Soma a duração de uma consulta (desde "inicio") à entrada de mesmo nome
+    // @return A duração em milissegundos
+    double registrarConsulta(const string &nome, chrono::steady_clock::time_point inicio, uint64_t resultados)
+    {
+        return registrar(consultas, nome, inicio, resultados);
+    }
+
+    // Grava o relatório em JSON
+    // @param arquivo_saida: Caminho do arquivo a ser criado
+    // @param bytes_arvore: Memória ocupada pela árvore (0 se ela foi mapeada de um snapshot)
+    // @param itens_arvore: Quantidade de nós da árvore
+    // @param vinculos_promovidos: Hardlinks que passaram a ser contados quando o nó
+    //        contado do mesmo inode saiu da árvore (ArvoreArquivos::vinculosPromovidos)
+    // @return true se o arquivo foi gravado por completo
+    // @example {"fases":[{"nome":"varredura","ms":812.4,"itens":1200000,"vezes":1},...],
+    //           "varredura":{"pastas":90000,"entradas":1200000,"entradas_por_s":1477000,...},
+    //           "chamadas_sistema":{"openat":90000,"getdents":180000,"stat":1110000,"total":1380000},
+    //           "erros":0,"roubos":412,"vinculos_promovidos":0,"memoria":{...},"consultas":[...]}
+    bool gravarJSON(const string &arquivo_saida, size_t bytes_arvore, size_t itens_arvore, uint64_t vinculos_promovidos)
+    {
+        FILE *arquivo = fopen(arquivo_saida.c_str(), "wb");
+        if (arquivo == nullptr)
+        {
+            return false;
+        }
+        bool falhou;
+        {
+            lock_guard<mutex> guarda(trava);
+            EscritorBuffer saida(arquivo, 64 * 1024);
+            double segundos_varredura = 0;
+            for (const Medida &fase : fases)
+            {
+                if (fase.nome == "varredura")
+                {
+                    segundos_varredura = fase.ms / 1000;
+                }
+            }
+            auto porSegundo = [&](uint64_t quantidade)
+            { return segundos_varredura > 0 ? static_cast<uint64_t>(quantidade / segundos_varredura) : 0; };
+
+            saida << "{\"fases\":";
+            escreverMedidas(saida, fases);
+            saida << ",\"varredura\":{\"pastas\":" << pastas_listadas.load() << ",\"entradas\":" << entradas_lidas.load()
+                  << ",\"entradas_por_s\":" << porSegundo(entradas_lidas) << ",\"pastas_por_s\":" << porSegundo(pastas_listadas)
+                  << "},\"chamadas_sistema\":{\"openat\":" << aberturas.load() << ",\"getdents\":" << leituras_diretorio.load()
+                  << ",\"stat\":" << stats.load() << ",\"total\":" << aberturas + leituras_diretorio + stats
+                  << "},\"erros\":" << erros.load() << ",\"roubos\":" << roubos.load()
+                  << ",\"vinculos_promovidos\":" << vinculos_promovidos
+                  << ",\"memoria\":{\"bytes_arvore\":" << bytes_arvore
+                  << ",\"bytes_por_item\":" << (itens_arvore ? bytes_arvore / itens_arvore : 0)
+                  << ",\"bytes_listagens\":" << bytes_listagens.load() << ",\"pico_rss_kb\":" << picoMemoriaKB()
+                  << "},\"consultas\":";
+            escreverMedidas(saida, consultas);
+            saida << "}\n";
+            saida.descarregar();
+            falhou = saida.falhou();
+        }
+        return fclose(arquivo) == 0 && !falhou;
+    }
+
+private:
+    double registrar(vector<Medida> &medidas, const string &nome, chrono::steady_clock::time_point inicio, uint64_t itens)
+    {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+        lock_guard<mutex> guarda(trava);
+        for (Medida &medida : medidas)
+        {
+            if (medida.nome == nome)
+            {
+                medida.ms += ms;
+                medida.itens += itens;
+                medida.vezes++;
+                return ms;
+            }
+        }
+        medidas.push_back({nome, ms, itens, 1});
+        return ms;
+    }
+
+    static void escreverMedidas(EscritorBuffer &saida, const vector<Medida> &medidas)
+    {
+        saida << '[';
+        for (size_t i = 0; i < medidas.size(); i++)
+        {
+            char ms[32];
+            snprintf(ms, sizeof(ms), "%.3f", medidas[i].ms);
+            saida << (i ? ",{\"nome\":" : "{\"nome\":");
+            escreverJSON(saida, medidas[i].nome);
+            saida << ",\"ms\":" << string_view(ms) << ",\"itens\":" << medidas[i].itens << ",\"vezes\":" << medidas[i].vezes << '}';
+        }
+        saida << ']';
+    }
+
+    mutex trava;
+    vector<Medida> fases;
+    vector<Medida> consultas;
+};
+
+static Instrumentacao instrumentacao;
+
+// Linha de progresso da varredura em stderr, atualizada a cada 250 ms enquanto o objeto existe
+// @note Só aparece quando instrumentacao.progresso está ligado (stderr é um terminal e
+//       não foi pedido --sem-progresso); ao terminar, a linha é apagada.
+class LinhaProgresso
+{
+public:
+    LinhaProgresso()
+    {
+        if (!instrumentacao.progresso)
+        {
+            return;
+        }
+        pastas_inicio = instrumentacao.pastas_listadas;
+        entradas_inicio = instrumentacao.entradas_lidas;
+        erros_inicio = instrumentacao.erros;
+        inicio = chrono::steady_clock::now();
+        atualizador = thread([this]
+                             { executar(); });
+    }
+
+    ~LinhaProgresso()
+    {
+        if (!atualizador.joinable())
+        {
+            return;
+        }
+        {
+            lock_guard<mutex> guarda(trava);
+            terminou = true;
+        }
+        aviso.notify_one();
+        atualizador.join();
+        if (escreveu)
+        {
+            cerr << "\r\033[K" << flush;
+        }
+    }
+
+    LinhaProgresso(const LinhaProgresso &) = delete;
+    LinhaProgresso &operator=(const LinhaProgresso &) = delete;
+
+private:
+    void executar()
+    {
+        unique_lock<mutex> guarda(trava);
+        while (!aviso.wait_for(guarda, chrono::milliseconds(250), [this]
+                               { return terminou; }))
+        {
+            double segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+            uint64_t entradas = instrumentacao.entradas_lidas - entradas_inicio;
+            cerr << "\r\033[KVarrendo: " << instrumentacao.pastas_listadas - pastas_inicio << " pastas, " << entradas
+                 << " entradas (" << static_cast<uint64_t>(entradas / segundos) << " entradas/s), "
+                 << instrumentacao.erros - erros_inicio << " erros" << flush;
+            escreveu = true;
+        }
+    }
+
+    thread atualizador;
+    mutex trava;
+    condition_variable aviso;
+    bool terminou = false;
+    bool escreveu = false;
+    uint64_t pastas_inicio = 0, entradas_inicio = 0, erros_inicio = 0;
+    chrono::steady_clock::time_point inicio;
+};
+
+// Conjunto compacto de identidades de arquivo (st_dev, st_ino)
+// @note Endereçamento aberto com sondagem linear em um único vetor de pares de 16
+//       bytes, sem alocação por elemento nem cópia de caminhos; a tabela dobra quando
+//       passa de metade da ocupação. O inode 0 marca posição livre (nenhum sistema
+//       de arquivos suportado o usa para entradas reais), então ele nunca é guardado.
+class TabelaInodes
+{
+public:
+    // Insere uma identidade
+    // @return false se ela já estava na tabela
+    bool inserir(uint64_t dispositivo, uint64_t inode)
+    {
+        if (inode == 0)
+        {
+            return true;
+        }
+        if ((ocupadas + 1) * 2 > posicoes.size())
+        {
+            crescer();
+        }
+        size_t mascara = posicoes.size() - 1;
+        for (size_t i = espalhar(dispositivo, inode) & mascara;; i = (i + 1) & mascara)
+        {
+            Chave &chave = posicoes[i];
+            if (chave.inode == 0)
+            {
+                chave = {dispositivo, inode};
+                ocupadas++;
+                return true;
+            }
+            if (chave.inode == inode && chave.dispositivo == dispositivo)
+            {
+                return false;
+            }
+        }
+    }
+
+    size_t size() const { return ocupadas; }
+
+private:
+    struct Chave
+    {
+        uint64_t dispositivo;
+        uint64_t inode;
+    };
+
+    static size_t espalhar(uint64_t dispositivo, uint64_t inode)
+    {
+        uint64_t h = inode * 0x9E3779B97F4A7C15ull ^ (dispositivo + 0x632BE59BD9B4E019ull);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+    void crescer()
+    {
+        vector<Chave> antigas(max<size_t>(64, posicoes.size() * 2));
+        antigas.swap(posicoes);
+        ocupadas = 0;
+        for (const Chave &chave : antigas)
+        {
+            if (chave.inode != 0)
+            {
+                inserir(chave.dispositivo, chave.inode);
+            }
+        }
+    }
+
+    vector<Chave> posicoes;
+    size_t ocupadas = 0;
+};
+
+// Resultado bruto da listagem de uma pasta, preenchido por um único worker.
+// Depois da varredura as listagens são convertidas em ArvoreArquivos em largura,
+// o que deixa os filhos de cada pasta com ids contíguos.
+struct ListagemPasta
+{
+    struct Entrada
+    {
+        uint32_t nome_inicio; // deslocamento em "nomes"
+        uint16_t nome_tamanho;
+        TipoNo tipo;
+        bool tamanho_pendente; // arquivo listado sem stat (carga com tamanhos depois)
+        int64_t tamanho;
+        unique_ptr<ListagemPasta> subpasta; // conteúdo da subpasta (só para pastas)
+    };
+    // Arquivo com mais de um hardlink (só no modo de uso em disco)
+    struct Vinculo
+    {
+        uint32_t entrada; // posição em "entradas"
+        uint64_t dispositivo;
+        uint64_t inode;
+    };
+    string nomes;
+    vector<Entrada> entradas;
+    vector<Vinculo> vinculos;
+    MetaPasta meta{}; // identidade e datas da própria pasta
+};
+
+// Uma pasta aguardando para ser listada por algum worker da varredura
+// listagem: onde os filhos da pasta serão gravados
+// caminho: caminho da pasta como foi percorrido (usado para abri-la)
+struct TarefaVarredura
+{
+    ListagemPasta *listagem;
+    string caminho;
+};
+
+// Fila de trabalho de um worker. O dono empilha e desempilha pelo fim (ordem em
+// profundidade, melhor localidade); os outros workers roubam pelo início, pegando
+// as pastas mais antigas, que tendem a ter as maiores subárvores.
+struct FilaVarredura
+{
+    mutex trava;
+    deque<TarefaVarredura> tarefas;
+};
+
+// Estado compartilhado entre os workers de uma varredura
+struct Varredura
+{
+    vector<FilaVarredura> filas;
+    atomic<size_t> pendentes{0}; // tarefas enfileiradas ou em execução
+    mutex trava_visitados;
+    TabelaInodes visitados; // (dispositivo, inode) das pastas já listadas
+    mutex trava_avisos;
+    atomic<size_t> total_entradas{0};
+    atomic<size_t> total_bytes_nomes{0};
+    bool uso_disco;
+    bool tamanhos_depois; // arquivos com d_type conhecido não recebem stat na varredura
+
+    Varredura(unsigned num_threads, bool uso_disco, bool tamanhos_depois)
+        : filas(num_threads), uso_disco(uso_disco), tamanhos_depois(tamanhos_depois) {}
+};
+
+// Entrada lida de um diretório com o tipo já resolvido
+struct EntradaDiretorio
+{
+    string nome;
+    unsigned char tipo; // DT_DIR, DT_REG, ... (DT_UNKNOWN quando o sistema de arquivos não informa)
+};
+
+// Lê todas as entradas de um diretório já aberto, ignorando "." e ".."
+// @param fd: Descritor do diretório (continua aberto após a chamada)
+// @param entradas: Vetor que recebe as entradas na ordem devolvida pelo sistema
+// @param chamadas: Recebe a soma das chamadas de leitura feitas (getdents64; uma com readdir)
+// @return true se a leitura terminou sem erros
+// @note No Linux usa getdents64 diretamente com um buffer grande (poucas chamadas
+//       de sistema por diretório); nos demais sistemas usa readdir sobre uma cópia do fd.
+static bool lerDiretorio(int fd, vector<EntradaDiretorio> &entradas, uint64_t &chamadas)
+{
+#ifdef __linux__
+    struct linux_dirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+    alignas(linux_dirent64) char buffer[64 * 1024];
+    while (true)
+    {
+        long lidos = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        chamadas++;
+        if (lidos == 0)
+        {
+            return true;
+        }
+        if (lidos < 0)
+        {
+            return false;
+        }
+        for (long pos = 0; pos < lidos;)
+        {
+            auto *d = reinterpret_cast<linux_dirent64 *>(buffer + pos);
+            pos += d->d_reclen;
+            if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+            {
+                continue;
+            }
+            entradas.push_back({d->d_name, d->d_type});
+        }
+    }
+#else
+    chamadas++;
+    int copia = dup(fd);
+    if (copia < 0)
+    {
+        return false;
+    }
+    DIR *dir = fdopendir(copia);
+    if (dir == nullptr)
+    {
+        close(copia);
+        return false;
+    }
+    errno = 0;
+    while (struct dirent *d = readdir(dir))
+    {
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+        {
+            continue;
+        }
+        entradas.push_back({d->d_name, d->d_type});
+    }
+    bool ok = (errno == 0);
+    closedir(dir);
+    return ok;
+#endif
+}
+
+// Resolve o tipo de uma entrada lida de um diretório
+// @param fd: Diretório aberto que contém a entrada
+// @param entrada: Entrada lida (o d_type pode vir como DT_UNKNOWN)
+// @param info: Recebe o resultado do stat, feito para arquivos (tamanho) e para
+//              entradas cujo tipo o sistema de arquivos não informou
+// @return DT_DIR, DT_REG, DT_UNKNOWN para entradas ignoradas (links, dispositivos, ...)
+//         ou -1 se o stat falhou (errno preenchido)
+static int classificarEntrada(int fd, const EntradaDiretorio &entrada, struct stat &info)
+{
+    if (entrada.tipo == DT_DIR)
+    {
+        return DT_DIR;
+    }
+    if (entrada.tipo != DT_UNKNOWN && entrada.tipo != DT_REG)
+    {
+        return DT_UNKNOWN;
+    }
+    if (fstatat(fd, entrada.nome.c_str(), &info, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return -1;
+    }
+    if (S_ISDIR(info.st_mode))
+    {
+        return DT_DIR;
+    }
+    return S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+}
+
+// Lista uma pasta e preenche a sua listagem
+// @param tarefa: Pasta a ser listada
+// @param varredura: Estado compartilhado (avisos e pastas visitadas)
+// @param subpastas: Recebe as tarefas das subpastas encontradas
+// @note Replica as regras da versão recursiva baseada em fs::directory_iterator:
+//       links simbólicos, dispositivos de bloco/caractere, FIFOs e sockets são ignorados;
+//       pastas sem permissão de leitura aparecem vazias e sem aviso.
+//       Cada pasta é identificada pelo par (st_dev, st_ino) do fstat feito logo após
+//       abri-la; uma pasta já listada por outro caminho (bind mount, laço) aparece
+//       vazia, sem canonicalizar caminhos.
+//       As listagens das subpastas pertencem à listagem do pai, que não é mais
+//       modificada depois desta chamada, então os ponteiros das tarefas continuam válidos.
+static void listarPasta(const TarefaVarredura &tarefa, Varredura &varredura, vector<TarefaVarredura> &subpastas)
+{
+    int fd = openat(AT_FDCWD, tarefa.caminho.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    instrumentacao.aberturas.fetch_add(1, memory_order_relaxed);
+    if (fd < 0)
+    {
+        instrumentacao.erros.fetch_add(1, memory_order_relaxed);
+        if (errno != EACCES)
+        {
+            lock_guard<mutex> guarda(varredura.trava_avisos);
+            cerr << "Aviso: não foi possível acessar \"" << tarefa.caminho << "\": " << strerror(errno) << endl;
+        }
+        return;
+    }
+
+    ListagemPasta &pasta = *tarefa.listagem;
+    uint64_t leituras = 0, stats = 1, erros = 0; // somados à instrumentação no final
+    struct stat info_pasta;
+    if (fstat(fd, &info_pasta) == 0)
+    {
+        pasta.meta = metaDe(info_pasta);
+        bool inedita;
+        {
+            // Evita listar a mesma pasta duas vezes
+            lock_guard<mutex> guarda(varredura.trava_visitados);
+            inedita = varredura.visitados.inserir(info_pasta.st_dev, info_pasta.st_ino);
+        }
+        if (!inedita)
+        {
+            close(fd);
+            instrumentacao.stats.fetch_add(stats, memory_order_relaxed);
+            return;
+        }
+    }
+
+    vector<EntradaDiretorio> entradas;
+    if (!lerDiretorio(fd, entradas, leituras))
+    {
+        erros++;
+        lock_guard<mutex> guarda(varredura.trava_avisos);
+        cerr << "Aviso: não foi possível acessar \"" << tarefa.caminho << "\": " << strerror(errno) << endl;
+    }
+
+    pasta.entradas.reserve(entradas.size());
+    for (const auto &entrada : entradas)
+    {
+        struct stat info;
+        bool pendente = varredura.tamanhos_depois && entrada.tipo == DT_REG;
+        int tipo = pendente ? DT_REG : classificarEntrada(fd, entrada, info);
+        stats += !pendente && (entrada.tipo == DT_REG || entrada.tipo == DT_UNKNOWN);
+        if (tipo < 0)
+        {
+            erros++;
+            lock_guard<mutex> guarda(varredura.trava_avisos);
+            cerr << "Aviso interno: não foi possível acessar \"" << juntarCaminho(tarefa.caminho, entrada.nome)
+                 << "\": " << strerror(errno) << endl;
+            continue;
+        }
+        if (tipo != DT_DIR && tipo != DT_REG)
+        {
+            continue;
+        }
+        int64_t tamanho = 0;
+        if (tipo == DT_REG && !pendente) // DT_UNKNOWN já passou pelo stat: o tamanho vem dele
+        {
+            tamanho = varredura.uso_disco ? static_cast<int64_t>(info.st_blocks) * 512 : static_cast<int64_t>(info.st_size);
+            if (varredura.uso_disco && info.st_nlink > 1)
+            {
+                pasta.vinculos.push_back({static_cast<uint32_t>(pasta.entradas.size()), static_cast<uint64_t>(info.st_dev),
+                                          static_cast<uint64_t>(info.st_ino)});
+            }
+        }
+        ListagemPasta::Entrada nova{static_cast<uint32_t>(pasta.nomes.size()),
+                                    static_cast<uint16_t>(entrada.nome.size()),
+                                    tipo == DT_DIR ? TipoNo::Pasta : TipoNo::Arquivo,
+                                    pendente,
+                                    tamanho,
+                                    nullptr};
+        pasta.nomes += entrada.nome;
+        if (tipo == DT_DIR)
+        {
+            nova.subpasta = make_unique<ListagemPasta>();
+            subpastas.push_back({nova.subpasta.get(), juntarCaminho(tarefa.caminho, entrada.nome)});
+        }
+        pasta.entradas.push_back(move(nova));
+    }
+    close(fd);
+
+    varredura.total_entradas.fetch_add(pasta.entradas.size(), memory_order_relaxed);
+    varredura.total_bytes_nomes.fetch_add(pasta.nomes.size(), memory_order_relaxed);
+    instrumentacao.pastas_listadas.fetch_add(1, memory_order_relaxed);
+    instrumentacao.entradas_lidas.fetch_add(entradas.size(), memory_order_relaxed);
+    instrumentacao.leituras_diretorio.fetch_add(leituras, memory_order_relaxed);
+    instrumentacao.stats.fetch_add(stats, memory_order_relaxed);
+    instrumentacao.erros.fetch_add(erros, memory_order_relaxed);
+    instrumentacao.bytes_listagens.fetch_add(sizeof(ListagemPasta) + pasta.nomes.capacity() +
+                                                 pasta.entradas.capacity() * sizeof(ListagemPasta::Entrada),
+                                             memory_order_relaxed);
+}
+
+// Laço de um worker: consome a própria fila e, quando ela esvazia, rouba tarefas
+// das filas dos outros workers até que não reste nenhuma pasta pendente
+// @param id: Índice do worker (e da sua fila) em varredura.filas
+static void workerVarredura(unsigned id, Varredura &varredura)
+{
+    const unsigned num_filas = varredura.filas.size();
+    vector<TarefaVarredura> subpastas;
+    unsigned tentativas_vazias = 0;
+
+    while (varredura.pendentes.load(memory_order_acquire) > 0)
+    {
+        TarefaVarredura tarefa{nullptr, ""};
+        bool achou = false;
+        {
+            FilaVarredura &propria = varredura.filas[id];
+            lock_guard<mutex> guarda(propria.trava);
+            if (!propria.tarefas.empty())
+            {
+                tarefa = move(propria.tarefas.back());
+                propria.tarefas.pop_back();
+                achou = true;
+            }
+        }
+        for (unsigned i = 1; !achou && i < num_filas; i++)
+        {
+            FilaVarredura &vitima = varredura.filas[(id + i) % num_filas];
+            lock_guard<mutex> guarda(vitima.trava);
+            if (!vitima.tarefas.empty())
+            {
+                tarefa = move(vitima.tarefas.front());
+                vitima.tarefas.pop_front();
+                achou = true;
+                instrumentacao.roubos.fetch_add(1, memory_order_relaxed);
+            }
+        }
+
+        if (!achou)
+        {
+            // Nada para roubar agora, mas outro worker ainda pode gerar subpastas
+            if (++tentativas_vazias < 64)
+            {
+                this_thread::yield();
+            }
+            else
+            {
+                this_thread::sleep_for(chrono::microseconds(100));
+            }
+            continue;
+        }
+        tentativas_vazias = 0;
+
+        subpastas.clear();
+        listarPasta(tarefa, varredura, subpastas);
+        if (!subpastas.empty())
+        {
+            // Incrementa antes de publicar, para que "pendentes" nunca chegue a zero cedo demais
+            varredura.pendentes.fetch_add(subpastas.size(), memory_order_relaxed);
+            FilaVarredura &propria = varredura.filas[id];
+            lock_guard<mutex> guarda(propria.trava);
+            for (auto &subpasta : subpastas)
+            {
+                propria.tarefas.push_back(move(subpasta));
+            }
+        }
+        varredura.pendentes.fetch_sub(1, memory_order_release);
+    }
+}
+
+// Função que carrega a árvore de diretórios REAL usando vários threads
+// @param caminho: Pasta raiz da varredura
+// @param num_threads: Quantidade de workers (0 = número de núcleos disponíveis)
+// @param uso_disco: Mede os arquivos pelos blocos alocados (st_blocks × 512) e conta
+//                   cada inode com vários hardlinks uma única vez nos totais
+// @param tamanhos_depois: Monta só a estrutura, pelo d_type, sem stat nos arquivos:
+//                         eles ficam com FLAG_TAMANHO_PENDENTE e 0 bytes até o
+//                         PreenchedorTamanhos ler os tamanhos. O índice de tamanhos
+//                         também fica para depois.
+// @return A árvore carregada, com a mesma estrutura da antiga varredura recursiva
+// @note Cada pasta encontrada vira uma tarefa em uma fila com roubo de trabalho
+//       (work stealing): o worker que a encontrou continua descendo por ela,
+//       enquanto workers ociosos roubam as pastas mais rasas pendentes. Assim
+//       todos os núcleos ficam ocupados até o disco saturar.
+//       O caminho canônico só é resolvido para a raiz (base dos caminhos exibidos e
+//       ponto de partida da varredura, então uma raiz que é link simbólico é seguida,
+//       mesmo com as pastas abertas com O_NOFOLLOW); pastas repetidas são
+//       detectadas pelo par (dispositivo, inode).
+//       Ao final, as listagens são copiadas em largura para o layout compacto. Nessa
+//       ordem, que não depende do escalonamento dos workers, o primeiro nó de cada
+//       inode com hardlinks fica com o tamanho e os demais são marcados como
+//       FLAG_VINCULO_REPETIDO, de forma determinística.
+ArvoreArquivos carregarArvore(const fs::path &caminho, unsigned num_threads = 0, bool uso_disco = false,
+                              bool tamanhos_depois = false)
+{
+    if (num_threads == 0)
+    {
+        num_threads = max(1u, thread::hardware_concurrency());
+    }
+
+    auto inicio_fase = chrono::steady_clock::now();
+    std::error_code erro;
+    fs::path canonico = fs::canonical(caminho, erro);
+    std::string caminhoStr = erro ? fs::absolute(caminho).string() : canonico.string();
+    auto listagem_raiz = make_unique<ListagemPasta>();
+    instrumentacao.registrarFase("caminho canonico", inicio_fase, 1);
+
+    Varredura varredura(num_threads, uso_disco, tamanhos_depois);
+    varredura.filas[0].tarefas.push_back({listagem_raiz.get(), caminhoStr});
+    varredura.pendentes = 1;
+
+    inicio_fase = chrono::steady_clock::now();
+    {
+        LinhaProgresso progresso;
+        vector<thread> workers;
+        for (unsigned i = 1; i < num_threads; i++)
+        {
+            workers.emplace_back(workerVarredura, i, ref(varredura));
+        }
+        workerVarredura(0, varredura);
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+    instrumentacao.registrarFase("varredura", inicio_fase, varredura.total_entradas);
+
+    inicio_fase = chrono::steady_clock::now();
+
+    ArvoreArquivos arvore(caminho.filename().string(), caminhoStr);
+    arvore.definirUsoDisco(uso_disco);
+    arvore.reservar(varredura.total_entradas + 1, varredura.total_bytes_nomes + caminho.filename().string().size());
+    deque<pair<unique_ptr<ListagemPasta>, uint32_t>> pendentes;
+    pendentes.emplace_back(move(listagem_raiz), arvore.raiz());
+    while (!pendentes.empty())
+    {
+        unique_ptr<ListagemPasta> listagem = move(pendentes.front().first);
+        uint32_t pai = pendentes.front().second;
+        pendentes.pop_front();
+
+        uint32_t primeiro = static_cast<uint32_t>(arvore.tamanho());
+        for (auto &entrada : listagem->entradas)
+        {
+            string_view nome(listagem->nomes.data() + entrada.nome_inicio, entrada.nome_tamanho);
+            uint32_t id = arvore.adicionarNo(nome, entrada.tipo, entrada.tamanho, pai);
+            if (entrada.tamanho_pendente)
+            {
+                arvore.marcarTamanhoPendente(id);
+            }
+            if (entrada.subpasta)
+            {
+                pendentes.emplace_back(move(entrada.subpasta), id);
+            }
+        }
+        arvore.definirFilhos(pai, primeiro, static_cast<uint32_t>(listagem->entradas.size()));
+        arvore.definirMeta(pai, listagem->meta);
+        for (const auto &vinculo : listagem->vinculos)
+        {
+            if (!arvore.registrarVinculo(primeiro + vinculo.entrada, vinculo.dispositivo, vinculo.inode))
+            {
+                arvore.marcarVinculoRepetido(primeiro + vinculo.entrada);
+            }
+        }
+    }
+    instrumentacao.registrarFase("linearizacao", inicio_fase, arvore.tamanho());
+
+    inicio_fase = chrono::steady_clock::now();
+    arvore.recalcularSubarvore(arvore.raiz());
+    instrumentacao.registrarFase("estatisticas", inicio_fase, arvore.tamanho());
+
+    inicio_fase = chrono::steady_clock::now();
+    arvore.garantirIndiceExtensoes();
+    if (!tamanhos_depois)
+    {
+        arvore.garantirIndiceTamanhos();
+    }
+    instrumentacao.registrarFase("indices", inicio_fase, arvore.tamanho());
+    return arvore;
+}
+
+// Relista uma única pasta e aplica à árvore as diferenças em relação ao disco
+// @param arvore: Árvore a atualizar
+// @param id: Pasta a sincronizar
+// @param pastas_novas: Recebe os ids das subpastas acrescentadas, ainda vazias: quem
+//                      chama carrega o conteúdo delas (ver recarregarPastas)
+// @return false se a pasta não pôde ser aberta (a árvore não é alterada)
+// @note Entradas novas são acrescentadas, entradas que sumiram são removidas e o
+//       tamanho dos arquivos existentes é atualizado. Subpastas que continuam
+//       existindo são mantidas como estão: quem chama decide se desce nelas.
+static bool sincronizarPasta(ArvoreArquivos &arvore, uint32_t id, vector<uint32_t> &pastas_novas)
+{
+    string caminho_pasta = arvore.caminho(id);
+    int fd = openat(AT_FDCWD, caminho_pasta.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    instrumentacao.aberturas.fetch_add(1, memory_order_relaxed);
+    if (fd < 0)
+    {
+        instrumentacao.erros.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    struct stat info_pasta;
+    if (fstat(fd, &info_pasta) == 0)
+    {
+        arvore.definirMeta(id, metaDe(info_pasta));
+    }
+    vector<EntradaDiretorio> entradas;
+    uint64_t leituras = 0, stats = 1;
+    if (!lerDiretorio(fd, entradas, leituras))
+    {
+        instrumentacao.erros.fetch_add(1, memory_order_relaxed);
+    }
+
+    unordered_map<string, uint32_t> existentes;
+    for (uint32_t filho : arvore.filhosDe(id))
+    {
+        existentes.emplace(string(arvore.nome(filho)), filho);
+    }
+
+    for (const auto &entrada : entradas)
+    {
+        struct stat info;
+        int tipo = classificarEntrada(fd, entrada, info);
+        stats += (entrada.tipo == DT_REG || entrada.tipo == DT_UNKNOWN);
+        if (tipo != DT_DIR && tipo != DT_REG)
+        {
+            continue;
+        }
+        auto existente = existentes.find(entrada.nome);
+        if (existente != existentes.end())
+        {
+            uint32_t filho = existente->second;
+            existentes.erase(existente);
+            if (arvore.ehArquivo(filho) == (tipo == DT_REG))
+            {
+                if (tipo == DT_REG)
+                {
+                    arvore.alterarTamanho(filho, arvore.tamanhoArquivo(info));
+                }
+                continue;
+            }
+            arvore.removerFilho(filho); // trocou de tipo: entra de novo abaixo
+        }
+        if (tipo == DT_REG)
+        {
+            arvore.adicionarArquivo(id, entrada.nome, info);
+        }
+        else
+        {
+            pastas_novas.push_back(arvore.adicionarFilho(id, entrada.nome, TipoNo::Pasta, 0));
+        }
+    }
+    close(fd);
+    instrumentacao.pastas_listadas.fetch_add(1, memory_order_relaxed);
+    instrumentacao.entradas_lidas.fetch_add(entradas.size(), memory_order_relaxed);
+    instrumentacao.leituras_diretorio.fetch_add(leituras, memory_order_relaxed);
+    instrumentacao.stats.fetch_add(stats, memory_order_relaxed);
+
+    for (const auto &[nome_filho, filho] : existentes)
+    {
+        arvore.removerFilho(filho);
+    }
+    return true;
+}
+
+// Percorre as pastas de uma subárvore e relista apenas as que mudaram desde a
+// última leitura (inode, mtime ou ctime diferentes do registrado na árvore)
+// @param arvore: Árvore a atualizar
+// @param id: Raiz da subárvore a revalidar
+// @param num_threads: Multiplicado por 4 (0 = 4 por núcleo), threads do stat das pastas
+// @param pastas_novas: Recebe os ids das subpastas acrescentadas, ainda vazias (ver
+//                      sincronizarPasta)
+// @return Quantidade de pastas relistadas
+// @note Custa um stat por pasta, feito em paralelo antes de qualquer alteração;
+//       arquivos só são consultados nas pastas alteradas. Subárvores de pastas
+//       inalteradas são reaproveitadas como estão: um arquivo reescrito no lugar
+//       não muda a data da pasta, então seu tamanho só é corrigido quando a pasta
+//       muda por outro motivo (ou pelo monitoramento).
+static size_t revalidarPastas(ArvoreArquivos &arvore, uint32_t id, unsigned num_threads, vector<uint32_t> &pastas_novas)
+{
+    // Pastas da subárvore em pré-ordem: as alterações de uma pasta chegam antes das subpastas
+    vector<uint32_t> pastas;
+    vector<uint32_t> pilha{id};
+    while (!pilha.empty())
+    {
+        uint32_t atual = pilha.back();
+        pilha.pop_back();
+        if (arvore.no(atual).tipo != TipoNo::Pasta)
+        {
+            continue;
+        }
+        pastas.push_back(atual);
+        IntervaloFilhos filhos = arvore.filhosDe(atual);
+        for (size_t i = filhos.size(); i > 0; i--)
+        {
+            if (!arvore.ehArquivo(filhos[i - 1]))
+            {
+                pilha.push_back(filhos[i - 1]);
+            }
+        }
+    }
+
+    // stat de todas as pastas em paralelo (a árvore ainda não foi alterada)
+    enum : uint8_t { IGUAL, MUDOU, SUMIU };
+    vector<uint8_t> situacao(pastas.size(), IGUAL);
+    atomic<size_t> proxima{0};
+    auto trabalhar = [&]
+    {
+        for (size_t i = proxima++; i < pastas.size(); i = proxima++)
+        {
+            struct stat info;
+            if (lstat(arvore.caminho(pastas[i]).c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+            {
+                situacao[i] = SUMIU;
+                continue;
+            }
+            const MetaPasta *meta = arvore.metaPasta(pastas[i]);
+            situacao[i] = (meta == nullptr || *meta != metaDe(info)) ? MUDOU : IGUAL;
+        }
+    };
+    unsigned threads_stat = num_threads ? 4 * num_threads : 4 * max(1u, thread::hardware_concurrency());
+    vector<thread> grupo;
+    for (unsigned i = 1; i < min<size_t>(threads_stat, pastas.size() / 64 + 1); i++)
+    {
+        grupo.emplace_back(trabalhar);
+    }
+    trabalhar();
+    for (auto &t : grupo)
+    {
+        t.join();
+    }
+    instrumentacao.stats.fetch_add(pastas.size(), memory_order_relaxed);
+
+    size_t relistadas = 0;
+    for (size_t i = 0; i < pastas.size(); i++)
+    {
+        uint32_t atual = pastas[i];
+        // Removida ao relistar uma pasta acima
+        if (situacao[i] == IGUAL || arvore.no(atual).tipo != TipoNo::Pasta)
+        {
+            continue;
+        }
+        if (situacao[i] == SUMIU)
+        {
+            if (atual != arvore.raiz())
+            {
+                arvore.removerFilho(atual);
+            }
+            continue;
+        }
+        if (sincronizarPasta(arvore, atual, pastas_novas))
+        {
+            relistadas++;
+        }
+    }
+    return relistadas;
+}
+
+// Mantém a árvore atualizada a partir dos eventos do sistema de arquivos (inotify)
+// @note Um thread em segundo plano lê os eventos em lotes e, com a trava de escrita,
+//       aplica criações, remoções, renomeações e mudanças de tamanho diretamente nos
+//       nós, propagando as diferenças para os ancestrais. Se a fila do kernel
+//       transbordar (eventos perdidos), as pastas são revalidadas pelo mtime e só as
+//       alteradas são relistadas. O custo acompanha o volume de mudanças, não o
+//       tamanho da árvore. Mudanças que acontecem entre a varredura inicial e a
+//       instalação dos observadores não são vistas até a próxima revalidação.
+//       Pastas criadas depois são observadas antes de listadas, e a listagem é feita
+//       sem a trava: só o enxerto do resultado bloqueia os leitores.
+//       fanotify exigiria privilégios de administrador, por isso não é usado.
+//       Disponível apenas no Linux.
+class MonitorArvore
+{
+public:
+    // @param arvore: Árvore a manter atualizada
+    // @param trava: Trava que protege a árvore (leitores usam shared_lock)
+    MonitorArvore(ArvoreArquivos &arvore, shared_mutex &trava) : arvore(arvore), trava(trava) {}
+
+    ~MonitorArvore() { parar(); }
+
+    // Instala os observadores em todas as pastas e inicia o thread de eventos
+    // @param erro: Recebe a descrição do problema quando o monitoramento não pode começar
+    // @return true se o monitoramento começou
+    bool iniciar(string &erro)
+    {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            erro = strerror(errno);
+            return false;
+        }
+        {
+            unique_lock<shared_mutex> escrita(trava);
+            observarSubarvore(arvore.raiz());
+        }
+        executando = true;
+        thread_eventos = thread(&MonitorArvore::executar, this);
+        return true;
+#else
+        erro = "monitoramento disponivel apenas no Linux (inotify)";
+        return false;
+#endif
+    }
+
+    // Encerra o thread de eventos
+    void parar()
+    {
+        executando = false;
+        if (thread_eventos.joinable())
+        {
+            thread_eventos.join();
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    bool ativo() const { return executando; }
+    size_t eventosAplicados() const { return eventos; }
+    size_t pastasObservadas() const { return no_por_observador.size(); }
+
+    // Passa a observar uma subárvore enxertada fora do monitor (recarga de pasta,
+    // pastas novas do comando "atualizar"); deve ser chamado com a trava de escrita
+    // @note O que mudou entre a varredura da subárvore e este momento é relistado, e
+    //       as pastas novas encontradas nisso são listadas pelo thread de eventos
+    void adotarSubarvore(uint32_t id)
+    {
+#ifdef __linux__
+        if (executando)
+        {
+            observarRevalidando(id);
+        }
+#else
+        (void)id;
+#endif
+    }
+
+private:
+#ifdef __linux__
+    static constexpr uint32_t MASCARA = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY |
+                                        IN_CLOSE_WRITE | IN_DONT_FOLLOW | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+    // Instala um observador em cada pasta de uma subárvore
+    void observarSubarvore(uint32_t id)
+    {
+        vector<uint32_t> pilha{id};
+        while (!pilha.empty())
+        {
+            uint32_t atual = pilha.back();
+            pilha.pop_back();
+            observar(atual);
+            for (uint32_t filho : arvore.filhosDe(atual))
+            {
+                if (!arvore.ehArquivo(filho))
+                {
+                    pilha.push_back(filho);
+                }
+            }
+        }
+    }
+
+    // Instala o observador de uma pasta (observar de novo a mesma pasta devolve o mesmo descritor)
+    void observar(uint32_t id)
+    {
+        int wd = inotify_add_watch(fd, arvore.caminho(id).c_str(), MASCARA);
+        if (wd >= 0)
+        {
+            auto [anterior, novo] = no_por_observador.try_emplace(wd, id);
+            if (!novo && anterior->second != id)
+            {
+                observador_por_no.erase(anterior->second); // pasta substituída por um enxerto
+                anterior->second = id;
+            }
+            observador_por_no[id] = wd;
+        }
+        else if (errno == ENOSPC && !avisou_limite)
+        {
+            avisou_limite = true;
+            cerr << "Aviso: limite de observadores do inotify atingido (fs.inotify.max_user_watches); "
+                 << "algumas pastas nao serao monitoradas" << endl;
+        }
+    }
+
+    // Remove os observadores das pastas de uma subárvore que está saindo da árvore
+    // (uma pasta movida para fora continuaria gerando eventos até ser apagada)
+    void esquecerSubarvore(uint32_t id)
+    {
+        vector<uint32_t> pilha{id};
+        while (!pilha.empty())
+        {
+            uint32_t atual = pilha.back();
+            pilha.pop_back();
+            auto observador = observador_por_no.find(atual);
+            if (observador != observador_por_no.end())
+            {
+                inotify_rm_watch(fd, observador->second);
+                no_por_observador.erase(observador->second);
+                observador_por_no.erase(observador);
+            }
+            for (uint32_t filho : arvore.filhosDe(atual))
+            {
+                if (!arvore.ehArquivo(filho))
+                {
+                    pilha.push_back(filho);
+                }
+            }
+        }
+    }
+
+    // Remove um item da árvore junto com os observadores da sua subárvore
+    void remover(uint32_t id)
+    {
+        if (!arvore.ehArquivo(id))
+        {
+            esquecerSubarvore(id);
+        }
+        arvore.removerFilho(id);
+    }
+
+    // Laço do thread: espera eventos e aplica cada lote lido com a trava de escrita
+    void executar()
+    {
+        alignas(inotify_event) char buffer[256 * 1024];
+        while (executando)
+        {
+            pollfd espera{fd, POLLIN, 0};
+            ssize_t lidos = poll(&espera, 1, 200) > 0 ? read(fd, buffer, sizeof(buffer)) : 0;
+            if (lidos > 0)
+            {
+                unique_lock<shared_mutex> escrita(trava);
+                processarLote(buffer, lidos);
+            }
+            listarPastasNovas(); // inclusive as agendadas por adotarSubarvore em outro thread
+        }
+    }
+
+    // Lista as pastas agendadas (criadas nos lotes ou achadas em uma revalidação), sem
+    // a trava, e enxerta o conteúdo com a trava de escrita
+    // @note O observador da pasta já foi instalado por agendarListagem: o que for
+    //       criado nela durante a listagem chega como evento no próximo lote. As
+    //       subpastas só são observadas depois do enxerto (observarRevalidando).
+    void listarPastasNovas()
+    {
+        while (a_listar.load(memory_order_acquire) > 0)
+        {
+            uint32_t id;
+            string caminho_pasta;
+            {
+                unique_lock<shared_mutex> escrita(trava);
+                tie(id, caminho_pasta) = move(pastas_a_listar.front());
+                pastas_a_listar.pop_front();
+                a_listar--;
+            }
+            ArvoreArquivos sub = carregarArvore(caminho_pasta, 1, arvore.usoDisco());
+            unique_lock<shared_mutex> escrita(trava);
+            if (arvore.no(id).tipo != TipoNo::Pasta)
+            {
+                continue; // removida durante a listagem
+            }
+            arvore.enxertar(id, sub);
+            observarRevalidando(id);
+        }
+    }
+
+    // Observa as pastas de uma subárvore recém-enxertada e a revalida (um stat por
+    // pasta) para relistar o que mudou entre a listagem e a instalação dos observadores
+    void observarRevalidando(uint32_t id)
+    {
+        observarSubarvore(id);
+        vector<uint32_t> pastas_novas;
+        revalidarPastas(arvore, id, 1, pastas_novas);
+        for (uint32_t nova : pastas_novas)
+        {
+            agendarListagem(nova);
+        }
+    }
+
+    // Observa uma pasta nova, ainda vazia na árvore, e agenda a listagem dela para
+    // depois do lote, fora da trava; observar antes de listar não perde o que for
+    // criado nela nesse meio tempo
+    void agendarListagem(uint32_t id)
+    {
+        observar(id);
+        pastas_a_listar.emplace_back(id, arvore.caminho(id));
+        a_listar++;
+    }
+
+    // Cria (ou atualiza) na árvore a entrada "nome" da pasta "pasta" a partir do disco
+    void criar(uint32_t pasta, const string &nome)
+    {
+        string caminho_entrada = juntarCaminho(arvore.caminho(pasta), nome);
+        struct stat info;
+        if (lstat(caminho_entrada.c_str(), &info) != 0 || !(S_ISDIR(info.st_mode) || S_ISREG(info.st_mode)))
+        {
+            return;
+        }
+        uint32_t existente = arvore.filhoPorNome(pasta, nome);
+        if (existente != ArvoreArquivos::SEM_PAI)
+        {
+            if (S_ISREG(info.st_mode) && arvore.ehArquivo(existente))
+            {
+                arvore.alterarTamanho(existente, arvore.tamanhoArquivo(info));
+                return;
+            }
+            if (S_ISDIR(info.st_mode) && arvore.no(existente).tipo == TipoNo::Pasta)
+            {
+                return; // já listada (ex: subpasta de uma pasta nova enxertada antes deste evento)
+            }
+            remover(existente);
+        }
+        if (S_ISREG(info.st_mode))
+        {
+            arvore.adicionarArquivo(pasta, nome, info);
+            return;
+        }
+        agendarListagem(arvore.adicionarFilho(pasta, nome, TipoNo::Pasta, 0));
+    }
+
+    // Aplica um lote de eventos lidos do inotify
+    void processarLote(const char *buffer, ssize_t tamanho)
+    {
+        unordered_map<uint32_t, uint32_t> saidas;   // cookie de IN_MOVED_FROM -> nó movido
+        set<pair<uint32_t, string>> tamanhos;       // (pasta, nome) de arquivos modificados
+        bool transbordou = false;
+
+        for (ssize_t pos = 0; pos < tamanho;)
+        {
+            const auto *evento = reinterpret_cast<const inotify_event *>(buffer + pos);
+            pos += sizeof(inotify_event) + evento->len;
+            eventos++;
+
+            if (evento->mask & IN_Q_OVERFLOW)
+            {
+                transbordou = true;
+                continue;
+            }
+            auto observador = no_por_observador.find(evento->wd);
+            if (observador == no_por_observador.end())
+            {
+                continue;
+            }
+            uint32_t pasta = observador->second;
+            if (evento->mask & IN_IGNORED)
+            {
+                observador_por_no.erase(pasta);
+                no_por_observador.erase(observador);
+                continue;
+            }
+            if (arvore.no(pasta).tipo != TipoNo::Pasta || evento->len == 0)
+            {
+                continue;
+            }
+            string nome = evento->name;
+
+            if (evento->mask & IN_MOVED_TO)
+            {
+                auto saida = saidas.find(evento->cookie);
+                if (saida != saidas.end() && arvore.no(saida->second).tipo != TipoNo::Removido)
+                {
+                    uint32_t existente = arvore.filhoPorNome(pasta, nome);
+                    if (existente != ArvoreArquivos::SEM_PAI && existente != saida->second)
+                    {
+                        remover(existente); // renomeação sobrescreveu um item
+                    }
+                    arvore.mover(saida->second, pasta, nome);
+                    saidas.erase(saida);
+                }
+                else
+                {
+                    criar(pasta, nome);
+                }
+            }
+            else if (evento->mask & IN_CREATE)
+            {
+                criar(pasta, nome);
+            }
+            else if (evento->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+                uint32_t filho = arvore.filhoPorNome(pasta, nome);
+                if (filho == ArvoreArquivos::SEM_PAI)
+                {
+                    continue;
+                }
+                if (evento->mask & IN_MOVED_FROM)
+                {
+                    saidas[evento->cookie] = filho;
+                }
+                else
+                {
+                    remover(filho);
+                }
+            }
+            else if (evento->mask & (IN_MODIFY | IN_CLOSE_WRITE))
+            {
+                tamanhos.emplace(pasta, move(nome));
+            }
+        }
+
+        // Itens movidos para fora da árvore (sem IN_MOVED_TO correspondente neste lote)
+        for (const auto &[cookie, filho] : saidas)
+        {
+            if (arvore.no(filho).tipo != TipoNo::Removido)
+            {
+                remover(filho);
+            }
+        }
+
+        // Um stat por arquivo modificado no lote, por mais eventos que ele tenha gerado
+        for (const auto &[pasta, nome] : tamanhos)
+        {
+            if (arvore.no(pasta).tipo != TipoNo::Pasta)
+            {
+                continue;
+            }
+            uint32_t filho = arvore.filhoPorNome(pasta, nome);
+            struct stat info;
+            if (filho != ArvoreArquivos::SEM_PAI && arvore.ehArquivo(filho) &&
+                lstat(juntarCaminho(arvore.caminho(pasta), nome).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            {
+                arvore.alterarTamanho(filho, arvore.tamanhoArquivo(info));
+            }
+        }
+
+        if (transbordou)
+        {
+            vector<uint32_t> pastas_novas;
+            revalidarPastas(arvore, arvore.raiz(), 1, pastas_novas);
+            for (uint32_t nova : pastas_novas)
+            {
+                agendarListagem(nova);
+            }
+            // Pastas removidas pela revalidação deixam de ser observadas
+            for (auto it = no_por_observador.begin(); it != no_por_observador.end();)
+            {
+                if (arvore.no(it->second).tipo != TipoNo::Pasta)
+                {
+                    inotify_rm_watch(fd, it->first);
+                    observador_por_no.erase(it->second);
+                    it = no_por_observador.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+#endif
+
+    ArvoreArquivos &arvore;
+    shared_mutex &trava;
+    int fd = -1;
+    thread thread_eventos;
+    atomic<bool> executando{false};
+    atomic<size_t> eventos{0};
+    unordered_map<int, uint32_t> no_por_observador; // descritor do inotify -> pasta
+    unordered_map<uint32_t, int> observador_por_no; // pasta -> descritor do inotify
+    deque<pair<uint32_t, string>> pastas_a_listar;  // pastas ainda vazias na árvore (protegidas pela trava)
+    atomic<size_t> a_listar{0};                     // tamanho de pastas_a_listar, lido sem a trava
+    bool avisou_limite = false;
+};
+
+// Carrega do disco o conteúdo de pastas da árvore e o enxerta no lugar do atual
+// @param arvore: Árvore a atualizar
+// @param trava: Trava que protege a árvore (leitores usam shared_lock)
+// @param pastas: Pastas a carregar (ex: as pastas novas de revalidarPastas, ainda vazias)
+// @param num_threads: Workers de cada varredura (0 = um por núcleo)
+// @param monitor: Monitoramento que passa a observar as pastas enxertadas (nullptr se não houver)
+// @return Quantidade de pastas enxertadas
+// @note A varredura de cada pasta é feita sem a trava; só o enxerto usa a trava de
+//       escrita, então os leitores não esperam pelo disco. Uma pasta removida
+//       enquanto era varrida é pulada.
+static size_t recarregarPastas(ArvoreArquivos &arvore, shared_mutex &trava, const vector<uint32_t> &pastas,
+                               unsigned num_threads, MonitorArvore *monitor)
+{
+    size_t enxertadas = 0;
+    for (uint32_t id : pastas)
+    {
+        string caminho_pasta;
+        {
+            shared_lock<shared_mutex> leitura(trava);
+            if (arvore.no(id).tipo != TipoNo::Pasta)
+            {
+                continue;
+            }
+            caminho_pasta = arvore.caminho(id);
+        }
+        ArvoreArquivos sub = carregarArvore(caminho_pasta, num_threads, arvore.usoDisco());
+        unique_lock<shared_mutex> escrita(trava);
+        if (arvore.no(id).tipo != TipoNo::Pasta)
+        {
+            continue;
+        }
+        arvore.enxertar(id, sub);
+        if (monitor != nullptr)
+        {
+            monitor->adotarSubarvore(id);
+        }
+        enxertadas++;
+    }
+    return enxertadas;
+}
+
+// Resultado do stat de um arquivo feito pelo PreenchedorTamanhos
+struct ResultadoStat
+{
+    int erro;              // 0 ou o código errno da falha
+    int64_t tamanho;       // st_size
+    int64_t blocos;        // st_blocks (unidades de 512 bytes)
+    uint64_t dispositivo;
+    uint64_t inode;
+    uint64_t vinculos;     // st_nlink
+};
+
+#ifdef TEM_IO_URING
+// Anel do io_uring usado só para pedidos IORING_OP_STATX, com chamadas de sistema
+// diretas (sem liburing)
+// @note Um único thread usa o anel: a cauda da fila de envio e a cabeça da fila de
+//       conclusão só são escritas aqui, então bastam as barreiras de aquisição e
+//       liberação nos índices compartilhados com o kernel.
+class AnelStatx
+{
+public:
+    AnelStatx() = default;
+    AnelStatx(const AnelStatx &) = delete;
+    AnelStatx &operator=(const AnelStatx &) = delete;
+
+    ~AnelStatx()
+    {
+        if (sqes != nullptr)
+        {
+            munmap(sqes, tamanho_sqes);
+        }
+        if (anel_cq != nullptr && anel_cq != anel_sq)
+        {
+            munmap(anel_cq, tamanho_cq);
+        }
+        if (anel_sq != nullptr)
+        {
+            munmap(anel_sq, tamanho_sq);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    // Cria o anel
+    // @param entradas: Tamanho da fila de envio (pedidos em voo ao mesmo tempo)
+    // @return false se o kernel não oferece io_uring ou ele está desativado
+    bool iniciar(unsigned entradas)
+    {
+        io_uring_params parametros{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entradas, &parametros));
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool mapa_unico = (parametros.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        tamanho_sq = parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned);
+        tamanho_cq = parametros.cq_off.cqes + parametros.cq_entries * sizeof(io_uring_cqe);
+        if (mapa_unico)
+        {
+            tamanho_sq = tamanho_cq = max(tamanho_sq, tamanho_cq);
+        }
+        anel_sq = mapear(tamanho_sq, IORING_OFF_SQ_RING);
+        anel_cq = mapa_unico ? anel_sq : mapear(tamanho_cq, IORING_OFF_CQ_RING);
+        tamanho_sqes = parametros.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(mapear(tamanho_sqes, IORING_OFF_SQES));
+        if (anel_sq == nullptr || anel_cq == nullptr || sqes == nullptr)
+        {
+            return false;
+        }
+        char *sq = static_cast<char *>(anel_sq);
+        char *cq = static_cast<char *>(anel_cq);
+        sq_cabeca = reinterpret_cast<unsigned *>(sq + parametros.sq_off.head);
+        sq_cauda = reinterpret_cast<unsigned *>(sq + parametros.sq_off.tail);
+        sq_mascara = *reinterpret_cast<unsigned *>(sq + parametros.sq_off.ring_mask);
+        sq_vetor = reinterpret_cast<unsigned *>(sq + parametros.sq_off.array);
+        cq_cabeca = reinterpret_cast<unsigned *>(cq + parametros.cq_off.head);
+        cq_cauda = reinterpret_cast<unsigned *>(cq + parametros.cq_off.tail);
+        cq_mascara = *reinterpret_cast<unsigned *>(cq + parametros.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + parametros.cq_off.cqes);
+        capacidade = parametros.sq_entries;
+        return true;
+    }
+
+    // Faz o statx de todos os caminhos, mantendo até "capacidade" pedidos em voo
+    // @param caminhos: Caminhos absolutos (links simbólicos não são seguidos)
+    // @param resultados: Recebe o resultado de cada caminho, na mesma posição
+    // @return false se o anel falhou ou o kernel não conhece IORING_OP_STATX (quem
+    //         chama deve refazer o lote de outra forma)
+    // @note Em caso de falha nenhum pedido novo é enviado, mas os que já estão em voo
+    //       ainda leem os caminhos e escrevem nos buffers: a função só retorna depois
+    //       de colher todas as conclusões. Se nem isso for possível, a memória deles
+    //       fica retida (ver reter) e "caminhos" recebe uma cópia.
+    bool statx(vector<string> &caminhos, vector<ResultadoStat> &resultados)
+    {
+        buffers.assign(caminhos.size(), {});
+        size_t proximo = 0, em_voo = 0;
+        bool falhou = false;
+        unsigned erros_seguidos = 0;
+        unsigned cauda = *sq_cauda;
+        while (em_voo > 0 || (!falhou && proximo < caminhos.size()))
+        {
+            for (; !falhou && proximo < caminhos.size() && em_voo < capacidade; proximo++, em_voo++)
+            {
+                unsigned posicao = cauda & sq_mascara;
+                io_uring_sqe &sqe = sqes[posicao];
+                memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_STATX;
+                sqe.fd = AT_FDCWD;
+                sqe.addr = reinterpret_cast<uint64_t>(caminhos[proximo].c_str());
+                sqe.len = STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_NLINK | STATX_INO;
+                sqe.off = reinterpret_cast<uint64_t>(&buffers[proximo]);
+                sqe.statx_flags = AT_SYMLINK_NOFOLLOW;
+                sqe.user_data = proximo;
+                sq_vetor[posicao] = posicao;
+                cauda++;
+            }
+            __atomic_store_n(sq_cauda, cauda, __ATOMIC_RELEASE);
+            unsigned a_enviar = cauda - __atomic_load_n(sq_cabeca, __ATOMIC_ACQUIRE);
+            if (syscall(__NR_io_uring_enter, fd, a_enviar, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+            {
+                falhou = true;
+                if (++erros_seguidos > 8)
+                {
+                    reter(caminhos);
+                    return false;
+                }
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            else
+            {
+                erros_seguidos = 0;
+            }
+            unsigned cabeca = *cq_cabeca;
+            unsigned fim = __atomic_load_n(cq_cauda, __ATOMIC_ACQUIRE);
+            for (; cabeca != fim; cabeca++, em_voo--)
+            {
+                const io_uring_cqe &cqe = cqes[cabeca & cq_mascara];
+                if (cqe.res == -EINVAL)
+                {
+                    falhou = true; // kernel sem IORING_OP_STATX (anterior ao 5.6)
+                    continue;
+                }
+                const struct statx &info = buffers[cqe.user_data];
+                resultados[cqe.user_data] = {cqe.res < 0 ? -cqe.res : 0,
+                                             static_cast<int64_t>(info.stx_size),
+                                             static_cast<int64_t>(info.stx_blocks),
+                                             static_cast<uint64_t>(makedev(info.stx_dev_major, info.stx_dev_minor)),
+                                             info.stx_ino,
+                                             info.stx_nlink};
+            }
+            __atomic_store_n(cq_cabeca, cabeca, __ATOMIC_RELEASE);
+        }
+        return !falhou;
+    }
+
+private:
+    // Retém até o fim do processo os caminhos e os buffers de pedidos que não puderam
+    // ser colhidos, já que o kernel ainda pode acessá-los; mover o vetor de caminhos
+    // preserva os endereços dos textos, e quem chama recebe uma cópia
+    void reter(vector<string> &caminhos)
+    {
+        static vector<vector<string>> caminhos_retidos;
+        static vector<vector<struct statx>> buffers_retidos;
+        caminhos_retidos.push_back(move(caminhos));
+        caminhos = caminhos_retidos.back();
+        buffers_retidos.push_back(move(buffers));
+    }
+
+    void *mapear(size_t tamanho, off_t deslocamento)
+    {
+        void *mapa = mmap(nullptr, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, deslocamento);
+        return mapa == MAP_FAILED ? nullptr : mapa;
+    }
+
+    int fd = -1;
+    void *anel_sq = nullptr;
+    void *anel_cq = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    size_t tamanho_sq = 0, tamanho_cq = 0, tamanho_sqes = 0;
+    unsigned *sq_cabeca = nullptr, *sq_cauda = nullptr, *sq_vetor = nullptr;
+    unsigned *cq_cabeca = nullptr, *cq_cauda = nullptr;
+    unsigned sq_mascara = 0, cq_mascara = 0;
+    io_uring_cqe *cqes = nullptr;
+    unsigned capacidade = 0;
+    vector<struct statx> buffers; // destino dos pedidos do lote atual
+};
+#endif
+
+// Preenche em segundo plano os tamanhos dos arquivos carregados só pela estrutura
+// (carregarArvore com tamanhos_depois)
+// @note Os arquivos pendentes são processados em lotes, na ordem dos ids. Em cada lote
+//       os caminhos são montados com a trava de leitura, os stats são feitos sem trava
+//       e os resultados são aplicados com a trava de escrita: os totais das pastas
+//       crescem a cada lote enquanto o menu já funciona. A aplicação segue a ordem
+//       dos ids (em largura), então no modo de uso em disco o primeiro hardlink de
+//       cada inode fica com o tamanho, como na carga completa.
+//       No Linux os stats de um lote vão juntos para o kernel pelo io_uring
+//       (IORING_OP_STATX), com centenas de pedidos em voo: em sistemas de arquivos de
+//       rede as latências se sobrepõem em vez de se somarem. Sem io_uring (kernel
+//       antigo, desativado, outros sistemas) um grupo de threads faz os stats.
+//       Um arquivo alterado pelo monitor antes do seu lote deixa de estar pendente e
+//       o resultado atrasado é descartado.
+class PreenchedorTamanhos
+{
+public:
+    // @param arvore: Árvore com arquivos marcados com FLAG_TAMANHO_PENDENTE
+    // @param trava: Trava que protege a árvore (leitores usam shared_lock)
+    PreenchedorTamanhos(ArvoreArquivos &arvore, shared_mutex &trava) : arvore(arvore), trava(trava) {}
+
+    ~PreenchedorTamanhos() { parar(); }
+
+    // Separa os arquivos pendentes e inicia o thread de preenchimento
+    // @param num_threads: Threads de stat quando não há io_uring (0 = 4 por núcleo)
+    // @note Deve ser chamado antes de outros threads alterarem a árvore
+    void iniciar(unsigned num_threads)
+    {
+        threads_stat = num_threads ? num_threads : 4 * max(1u, thread::hardware_concurrency());
+        for (uint32_t id = 0; id < arvore.tamanho(); id++)
+        {
+            if (arvore.ehArquivo(id) && arvore.tamanhoPendente(id))
+            {
+                ids.push_back(id);
+            }
+        }
+        pendentes = ids.size();
+#ifdef TEM_IO_URING
+        anel = make_unique<AnelStatx>();
+        usando_io_uring = anel->iniciar(256);
+#endif
+        executando = true;
+        thread_preenchimento = thread(&PreenchedorTamanhos::executar, this);
+    }
+
+    // Espera todos os tamanhos serem preenchidos
+    void aguardar()
+    {
+        if (thread_preenchimento.joinable())
+        {
+            thread_preenchimento.join();
+        }
+    }
+
+    // Interrompe o preenchimento (ao final do lote atual)
+    void parar()
+    {
+        executando = false;
+        aguardar();
+    }
+
+    bool ativo() const { return executando; }
+    size_t preenchidos() const { return feitos; }
+    size_t total() const { return pendentes; }
+    const char *metodo() const { return usando_io_uring ? "io_uring" : "threads"; }
+
+private:
+    static constexpr size_t TAMANHO_LOTE = 4096;
+
+    void executar()
+    {
+        auto inicio = chrono::steady_clock::now();
+        const bool uso_disco = arvore.usoDisco();
+        vector<string> caminhos;
+        vector<ResultadoStat> resultados;
+        for (size_t inicio_lote = 0; inicio_lote < ids.size() && executando; inicio_lote += TAMANHO_LOTE)
+        {
+            size_t fim_lote = min(ids.size(), inicio_lote + TAMANHO_LOTE);
+            caminhos.clear();
+            {
+                shared_lock<shared_mutex> leitura(trava);
+                for (size_t i = inicio_lote; i < fim_lote; i++)
+                {
+                    caminhos.push_back(arvore.caminho(ids[i]));
+                }
+            }
+            resultados.assign(caminhos.size(), ResultadoStat{});
+#ifdef TEM_IO_URING
+            if (usando_io_uring && !anel->statx(caminhos, resultados))
+            {
+                usando_io_uring = false;
+            }
+#endif
+            if (!usando_io_uring)
+            {
+                statComThreads(caminhos, resultados);
+            }
+
+            uint64_t erros = 0;
+            {
+                unique_lock<shared_mutex> escrita(trava);
+                for (size_t i = 0; i < caminhos.size(); i++)
+                {
+                    const ResultadoStat &r = resultados[i];
+                    erros += (r.erro != 0);
+                    int64_t tamanho = (r.erro != 0) ? 0 : (uso_disco ? r.blocos * 512 : r.tamanho);
+                    uint32_t id = ids[inicio_lote + i];
+                    bool repetido = r.erro == 0 && uso_disco && r.vinculos > 1 && arvore.ehArquivo(id) &&
+                                    arvore.tamanhoPendente(id) && !arvore.registrarVinculo(id, r.dispositivo, r.inode);
+                    arvore.preencherTamanho(ids[inicio_lote + i], tamanho, repetido);
+                }
+            }
+            instrumentacao.stats.fetch_add(caminhos.size(), memory_order_relaxed);
+            instrumentacao.erros.fetch_add(erros, memory_order_relaxed);
+            feitos += caminhos.size();
+        }
+
+        {
+            shared_lock<shared_mutex> leitura(trava);
+            arvore.garantirIndiceTamanhos();
+        }
+        instrumentacao.registrarFase(string("tamanhos (") + metodo() + ")", inicio, feitos);
+        executando = false;
+    }
+
+    // Faz os stats de um lote dividindo-o entre vários threads
+    void statComThreads(const vector<string> &caminhos, vector<ResultadoStat> &resultados)
+    {
+        atomic<size_t> proximo{0};
+        auto trabalhar = [&]
+        {
+            for (size_t i = proximo++; i < caminhos.size(); i = proximo++)
+            {
+                struct stat info;
+                if (fstatat(AT_FDCWD, caminhos[i].c_str(), &info, AT_SYMLINK_NOFOLLOW) != 0)
+                {
+                    resultados[i].erro = errno;
+                    continue;
+                }
+                resultados[i] = {0, static_cast<int64_t>(info.st_size), static_cast<int64_t>(info.st_blocks),
+                                 static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino),
+                                 static_cast<uint64_t>(info.st_nlink)};
+            }
+        };
+        vector<thread> grupo;
+        for (unsigned i = 1; i < min<size_t>(threads_stat, caminhos.size()); i++)
+        {
+            grupo.emplace_back(trabalhar);
+        }
+        trabalhar();
+        for (auto &t : grupo)
+        {
+            t.join();
+        }
+    }
+
+    ArvoreArquivos &arvore;
+    shared_mutex &trava;
+    thread thread_preenchimento;
+    atomic<bool> executando{false};
+    atomic<size_t> feitos{0};
+    atomic<size_t> pendentes{0};
+    atomic<bool> usando_io_uring{false};
+    unsigned threads_stat = 1;
+    vector<uint32_t> ids; // arquivos pendentes, em ordem crescente
+#ifdef TEM_IO_URING
+    unique_ptr<AnelStatx> anel;
+#endif
+};
+
+// Hash não criptográfico de 128 bits do conteúdo de um arquivo, calculado aos pedaços
+// @note Duas linhas de 64 bits independentes, alimentadas 8 bytes por vez; o
+//       tamanho total entra no final. Serve para separar arquivos diferentes, não
+//       resiste a colisões construídas de propósito.
+struct HashConteudo
+{
+    uint64_t a = 0x243F6A8885A308D3ull;
+    uint64_t b = 0x13198A2E03707344ull;
+    uint64_t total = 0;
+    unsigned char resto[8];
+    size_t usados = 0; // bytes em "resto" esperando completar uma palavra
+
+    void atualizar(const char *dados, size_t tamanho)
+    {
+        total += tamanho;
+        while (usados > 0 && usados < 8 && tamanho > 0)
+        {
+            resto[usados++] = static_cast<unsigned char>(*dados++);
+            tamanho--;
+        }
+        if (usados == 8)
+        {
+            palavra(resto);
+            usados = 0;
+        }
+        for (; tamanho >= 8; dados += 8, tamanho -= 8)
+        {
+            palavra(dados);
+        }
+        memcpy(resto + usados, dados, tamanho);
+        usados += tamanho;
+    }
+
+    pair<uint64_t, uint64_t> resultado()
+    {
+        memset(resto + usados, 0, 8 - usados);
+        palavra(resto);
+        uint64_t fim_a = misturarHash(a ^ total), fim_b = misturarHash(b + total);
+        return {misturarHash(fim_a + fim_b), misturarHash(fim_b ^ (fim_a >> 1))};
+    }
+
+private:
+    void palavra(const void *dados)
+    {
+        uint64_t w;
+        memcpy(&w, dados, 8);
+        a = a ^ misturarHash(w);
+        a = ((a << 27) | (a >> 37)) * 0x9E3779B97F4A7C15ull;
+        b = (b + w) * 0xC2B2AE3D27D4EB4Full;
+        b ^= b >> 31;
+    }
+};
+
+// Um conjunto de arquivos com o mesmo conteúdo
+struct ConjuntoDuplicados
+{
+    int64_t tamanho;         // tamanho de cada arquivo
+    vector<uint32_t> ids;    // arquivos do conjunto, em ordem crescente (um por inode)
+    vector<string> caminhos; // caminho de cada id, do momento em que a busca começou
+    int64_t recuperavel() const { return tamanho * static_cast<int64_t>(ids.size() - 1); }
+};
+
+// Resultado de encontrarDuplicados, com os contadores de cada estágio
+struct ResultadoDuplicados
+{
+    vector<ConjuntoDuplicados> conjuntos; // do que libera mais espaço para o que libera menos
+    int64_t recuperavel = 0;              // bytes liberados mantendo um arquivo por conjunto
+    size_t candidatos = 0;                // arquivos com tamanho repetido (os únicos abertos)
+    size_t leituras_completas = 0;        // arquivos lidos por inteiro
+    uint64_t bytes_lidos = 0;
+};
+
+// Bytes lidos do início e do fim de cada candidato no estágio parcial
+static constexpr int64_t BYTES_PONTAS_DUPLICADOS = 4096;
+
+// Um arquivo candidato da busca por duplicados, copiado da árvore para ser lido sem a trava
+struct CandidatoDuplicado
+{
+    uint32_t id;
+    int64_t tamanho;
+    string caminho;
+};
+
+// Identidade e hash do conteúdo (parcial ou completo) de um arquivo candidato
+struct AssinaturaArquivo
+{
+    bool valida = false; // false se o arquivo sumiu, não é regular ou mudou de tamanho
+    uint64_t dispositivo = 0;
+    uint64_t inode = 0;
+    pair<uint64_t, uint64_t> hash;
+};
+
+// Abre um candidato e calcula o hash das pontas (ou do arquivo inteiro)
+// @param candidato: Arquivo a ler, com o tamanho registrado na árvore
+// @param uso_disco: Modo de tamanho da árvore (o tamanho é conferido no mesmo modo)
+// @param completo: Lê o arquivo inteiro em vez do início e do fim
+// @param buffer: Buffer de leitura do thread (leituras sequenciais grandes)
+// @param bytes_lidos: Acumula os bytes lidos
+static AssinaturaArquivo assinarArquivo(const CandidatoDuplicado &candidato, bool uso_disco, bool completo,
+                                        vector<char> &buffer, uint64_t &bytes_lidos)
+{
+    AssinaturaArquivo assinatura;
+    int fd = open(candidato.caminho.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    instrumentacao.aberturas.fetch_add(1, memory_order_relaxed);
+    if (fd < 0)
+    {
+        instrumentacao.erros.fetch_add(1, memory_order_relaxed);
+        return assinatura;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+        (uso_disco ? static_cast<int64_t>(info.st_blocks) * 512 : static_cast<int64_t>(info.st_size)) != candidato.tamanho)
+    {
+        close(fd);
+        return assinatura;
+    }
+    assinatura.dispositivo = static_cast<uint64_t>(info.st_dev);
+    assinatura.inode = static_cast<uint64_t>(info.st_ino);
+    const int64_t bytes = static_cast<int64_t>(info.st_size);
+    HashConteudo hash;
+    auto lerEm = [&](int64_t inicio, int64_t quantidade)
+    {
+        while (quantidade > 0)
+        {
+            ssize_t lidos = pread(fd, buffer.data(), static_cast<size_t>(min<int64_t>(quantidade, buffer.size())), inicio);
+            if (lidos <= 0)
+            {
+                return lidos == 0; // fim antecipado: o arquivo encolheu durante a leitura
+            }
+            hash.atualizar(buffer.data(), static_cast<size_t>(lidos));
+            bytes_lidos += static_cast<uint64_t>(lidos);
+            inicio += lidos;
+            quantidade -= lidos;
+        }
+        return true;
+    };
+    bool ok;
+    if (!completo && bytes > 2 * BYTES_PONTAS_DUPLICADOS)
+    {
+        ok = lerEm(0, BYTES_PONTAS_DUPLICADOS) && lerEm(bytes - BYTES_PONTAS_DUPLICADOS, BYTES_PONTAS_DUPLICADOS);
+    }
+    else
+    {
+#ifdef __linux__
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        ok = lerEm(0, bytes);
+    }
+    close(fd);
+    if (!ok)
+    {
+        instrumentacao.erros.fetch_add(1, memory_order_relaxed);
+        return assinatura;
+    }
+    assinatura.hash = hash.resultado();
+    assinatura.valida = true;
+    return assinatura;
+}
+
+// Candidatos da busca por duplicados: os arquivos cujo tamanho aparece mais de uma vez
+// @param arvore: Árvore consultada (com a trava de leitura, quando há uma)
+// @param tamanho_minimo: Menor tamanho considerado (arquivos vazios são todos iguais)
+// @return Id, tamanho e caminho de cada candidato, agrupados por tamanho
+// @note É o único passo da busca que consulta a árvore: os caminhos são copiados
+//       para que o conteúdo seja lido por encontrarDuplicados sem a trava, sem
+//       bloquear o monitoramento durante a leitura dos arquivos.
+static vector<CandidatoDuplicado> candidatosDuplicados(const ArvoreArquivos &arvore, int64_t tamanho_minimo)
+{
+    // O índice de tamanhos já vem agrupado por tamanho
+    auto inicio = chrono::steady_clock::now();
+    vector<CandidatoDuplicado> candidatos;
+    auto arquivos = arvore.arquivosEntre(max<int64_t>(tamanho_minimo, 1), INT64_MAX);
+    for (size_t i = 0; i < arquivos.size();)
+    {
+        size_t fim = i;
+        while (fim < arquivos.size() && arquivos[fim].second == arquivos[i].second)
+        {
+            fim++;
+        }
+        for (size_t j = i; fim - i > 1 && j < fim; j++)
+        {
+            candidatos.push_back({arquivos[j].first, arquivos[j].second, arvore.caminho(arquivos[j].first)});
+        }
+        i = fim;
+    }
+    instrumentacao.registrarFase("duplicados: tamanhos", inicio, candidatos.size());
+    return candidatos;
+}
+
+// Encontra conjuntos de arquivos com conteúdo idêntico
+// @param candidatos: Resultado de candidatosDuplicados
+// @param uso_disco: Modo de tamanho da árvore de onde vieram os candidatos
+// @param num_threads: Leituras simultâneas (0 = 4 ou uma por núcleo, o que for maior)
+// @return Os conjuntos encontrados e os contadores de leitura
+// @note Não consulta a árvore, então roda sem a trava de leitura; arquivos que
+//       mudaram de tamanho ou sumiram desde a cópia dos candidatos são descartados.
+//       Estágios: (1) em candidatosDuplicados, o índice de tamanhos agrupa os arquivos
+//       e só os tamanhos repetidos viram candidatos, então nenhum arquivo de tamanho único
+//       é aberto; (2) o hash dos primeiros e últimos 4 KB separa a maioria dos
+//       falsos candidatos (arquivos de até 8 KB já são lidos inteiros aqui);
+//       (3) só quem ainda colide é lido por inteiro, em blocos de 1 MB. Hardlinks
+//       (mesmo dispositivo e inode) contam como um arquivo só: não liberam espaço e
+//       são lidos uma vez. Os threads pegam o próximo arquivo de um contador
+//       atômico, então há no máximo num_threads leituras em andamento.
+//       No modo de uso em disco, os grupos são por blocos alocados.
+static ResultadoDuplicados encontrarDuplicados(const vector<CandidatoDuplicado> &candidatos, bool uso_disco,
+                                               unsigned num_threads)
+{
+    ResultadoDuplicados resultado;
+    if (num_threads == 0)
+    {
+        num_threads = max(4u, thread::hardware_concurrency());
+    }
+
+    // Executa ler(i, buffer, bytes_lidos) para i em [0, quantidade) com num_threads threads
+    auto emParalelo = [&](size_t quantidade, auto &&ler)
+    {
+        atomic<size_t> proximo{0};
+        atomic<uint64_t> bytes{0};
+        auto trabalhar = [&]
+        {
+            vector<char> buffer(1 << 20);
+            uint64_t lidos = 0;
+            for (size_t i = proximo++; i < quantidade; i = proximo++)
+            {
+                ler(i, buffer, lidos);
+            }
+            bytes += lidos;
+        };
+        vector<thread> grupo;
+        for (unsigned t = 1; t < min<size_t>(num_threads, quantidade); t++)
+        {
+            grupo.emplace_back(trabalhar);
+        }
+        trabalhar();
+        for (auto &t : grupo)
+        {
+            t.join();
+        }
+        resultado.bytes_lidos += bytes;
+    };
+
+    resultado.candidatos = candidatos.size();
+
+    // Agrupa itens com a mesma chave (tamanho, hash), um por inode, e chama
+    // grupo(itens) para os grupos com dois ou mais inodes distintos
+    struct Item
+    {
+        uint32_t id;
+        int64_t tamanho;
+        AssinaturaArquivo assinatura;
+        size_t candidato; // posição em "candidatos"
+    };
+    auto agrupar = [](vector<Item> &itens, auto &&grupo)
+    {
+        sort(itens.begin(), itens.end(), [](const Item &x, const Item &y)
+             { return tie(y.tamanho, x.assinatura.hash, x.id) < tie(x.tamanho, y.assinatura.hash, y.id); });
+        for (size_t i = 0; i < itens.size();)
+        {
+            size_t fim = i;
+            while (fim < itens.size() && itens[fim].tamanho == itens[i].tamanho && itens[fim].assinatura.hash == itens[i].assinatura.hash)
+            {
+                fim++;
+            }
+            vector<Item> unicos;
+            set<pair<uint64_t, uint64_t>> inodes;
+            for (size_t j = i; j < fim; j++)
+            {
+                if (inodes.insert({itens[j].assinatura.dispositivo, itens[j].assinatura.inode}).second)
+                {
+                    unicos.push_back(itens[j]);
+                }
+            }
+            if (unicos.size() > 1)
+            {
+                grupo(unicos);
+            }
+            i = fim;
+        }
+    };
+    auto registrar = [&](const vector<Item> &itens)
+    {
+        vector<pair<uint32_t, size_t>> ordem; // (id, candidato), em ordem crescente de id
+        for (const Item &item : itens)
+        {
+            ordem.emplace_back(item.id, item.candidato);
+        }
+        sort(ordem.begin(), ordem.end());
+        ConjuntoDuplicados conjunto{itens[0].tamanho, {}, {}};
+        for (const auto &[id, candidato] : ordem)
+        {
+            conjunto.ids.push_back(id);
+            conjunto.caminhos.push_back(candidatos[candidato].caminho);
+        }
+        resultado.conjuntos.push_back(move(conjunto));
+    };
+
+    // Hash das pontas de todos os candidatos
+    auto inicio = chrono::steady_clock::now();
+    vector<Item> parciais(candidatos.size());
+    emParalelo(candidatos.size(), [&](size_t i, vector<char> &buffer, uint64_t &lidos)
+               { parciais[i] = {candidatos[i].id, candidatos[i].tamanho, assinarArquivo(candidatos[i], uso_disco, false, buffer, lidos), i}; });
+    parciais.erase(remove_if(parciais.begin(), parciais.end(), [](const Item &item)
+                             { return !item.assinatura.valida; }),
+                   parciais.end());
+    vector<Item> completos;
+    agrupar(parciais, [&](const vector<Item> &itens)
+            {
+        if (itens[0].tamanho <= 2 * BYTES_PONTAS_DUPLICADOS)
+        {
+            registrar(itens); // as pontas já cobriram o arquivo inteiro
+        }
+        else
+        {
+            completos.insert(completos.end(), itens.begin(), itens.end());
+        } });
+    instrumentacao.registrarFase("duplicados: pontas", inicio, parciais.size());
+
+    // Hash completo de quem ainda colide
+    inicio = chrono::steady_clock::now();
+    resultado.leituras_completas = completos.size();
+    emParalelo(completos.size(), [&](size_t i, vector<char> &buffer, uint64_t &lidos)
+               { completos[i].assinatura = assinarArquivo(candidatos[completos[i].candidato], uso_disco, true, buffer, lidos); });
+    completos.erase(remove_if(completos.begin(), completos.end(), [](const Item &item)
+                              { return !item.assinatura.valida; }),
+                    completos.end());
+    agrupar(completos, registrar);
+    instrumentacao.registrarFase("duplicados: conteudo", inicio, completos.size());
+
+    for (const ConjuntoDuplicados &conjunto : resultado.conjuntos)
+    {
+        resultado.recuperavel += conjunto.recuperavel();
+    }
+    sort(resultado.conjuntos.begin(), resultado.conjuntos.end(), [](const ConjuntoDuplicados &x, const ConjuntoDuplicados &y)
+         { return x.recuperavel() != y.recuperavel() ? x.recuperavel() > y.recuperavel() : x.ids[0] < y.ids[0]; });
+    return resultado;
+}
+
+// Uma consulta do modo não interativo, no formato "tipo" ou "tipo=argumento"
+// Tipos aceitos: maior, extensao=EXT, vazias, maiores=N, pasta-mais-arquivos,
+//                glob=PADRAO, regex=EXPRESSAO, duplicados, html=ARQUIVO, html-recolhivel=ARQUIVO
+struct Consulta
+{
+    string tipo;
+    string argumento;
+    int64_t limite = 0; // N de "maiores", já interpretado
+};
+
+// Interpreta uma consulta da linha de comando
+// @param texto: Consulta como digitada (ex: "extensao=.log")
+// @param consulta: Recebe a consulta interpretada
+// @return false se o tipo é desconhecido, falta o argumento obrigatório ou o
+//         argumento é inválido (ex: "maiores" negativo ou fora do intervalo de int64_t)
+static bool interpretarConsulta(const string &texto, Consulta &consulta)
+{
+    size_t igual = texto.find('=');
+    consulta.tipo = texto.substr(0, igual);
+    consulta.argumento = (igual == string::npos) ? "" : texto.substr(igual + 1);
+    static const unordered_set<string> sem_argumento{"maior", "vazias", "pasta-mais-arquivos", "duplicados"};
+    static const unordered_set<string> com_argumento{"extensao", "maiores", "glob", "regex", "html", "html-recolhivel"};
+    if (sem_argumento.count(consulta.tipo))
+    {
+        return true;
+    }
+    if (!com_argumento.count(consulta.tipo) || consulta.argumento.empty())
+    {
+        return false;
+    }
+    if (consulta.tipo == "maiores")
+    {
+        const char *inicio = consulta.argumento.data(), *fim = inicio + consulta.argumento.size();
+        auto [resto, ec] = from_chars(inicio, fim, consulta.limite);
+        return ec == errc() && resto == fim && consulta.limite >= 0;
+    }
+    if (consulta.tipo == "regex")
+    {
+        PadraoNome padrao;
+        string erro;
+        return padrao.compilar(consulta.argumento, true, erro);
+    }
+    return true;
+}
+
+// Executa uma lista de consultas e escreve os resultados em JSON, um objeto por linha
+// @param arvore: Árvore consultada
+// @param consultas: Consultas na ordem em que os resultados devem sair
+// @param saida: Escritor que recebe as linhas JSON
+// @param num_threads: Threads da travessia fundida (0 = uma por núcleo)
+// @param leitura: Trava de leitura da árvore segurada pelo chamador, se houver; é
+//        liberada enquanto "duplicados" lê o conteúdo dos arquivos
+// @return false se alguma exportação falhou
+// @note "duplicados" é calculado antes de tudo, porque a trava é liberada durante a
+//       leitura dos arquivos: os ids guardados pelas demais consultas são obtidos só
+//       depois de retomá-la, e o resultado de "duplicados" já sai como caminhos.
+// @note As consultas que têm índice pronto (extensão e tamanhos) são respondidas
+//       por ele. As demais são respondidas juntas em uma única busca em profundidade:
+//       cada nó é visitado uma vez e alimenta todas as consultas pendentes, em vez
+//       de uma travessia completa por consulta. A busca é dividida em subárvores
+//       por percorrerEmParalelo, e a saída é a mesma de uma travessia serial.
+// @example Saída para "maior" e "vazias":
+//          {"consulta":"maior","caminho":"/dados/a.iso","tamanho":4700000000}
+//          {"consulta":"vazias","caminho":"/dados/tmp"}
+static bool executarConsultas(const ArvoreArquivos &arvore, const vector<Consulta> &consultas, EscritorBuffer &saida,
+                              unsigned num_threads = 0, shared_lock<shared_mutex> *leitura = nullptr)
+{
+    // Duplicados primeiro: a árvore pode mudar enquanto a trava está liberada
+    ResultadoDuplicados duplicados;
+    if (any_of(consultas.begin(), consultas.end(), [](const Consulta &c) { return c.tipo == "duplicados"; }))
+    {
+        vector<CandidatoDuplicado> candidatos = candidatosDuplicados(arvore, 1);
+        if (leitura)
+        {
+            leitura->unlock();
+        }
+        duplicados = encontrarDuplicados(candidatos, arvore.usoDisco(), num_threads);
+        if (leitura)
+        {
+            leitura->lock();
+        }
+    }
+
+    const bool usar_indice_tamanhos = arvore.indiceTamanhosPronto();
+    const bool usar_indice_extensoes = arvore.indiceExtensoesPronto();
+
+    // Define o que a travessia fundida precisa calcular
+    bool calc_maior = false, calc_vazias = false, calc_pasta = false;
+    unordered_map<string, size_t> extensoes; // extensão normalizada -> posição em Parcial::por_extensao
+    vector<int64_t> limites;                 // N das consultas "maiores", em ordem crescente
+    for (const Consulta &consulta : consultas)
+    {
+        calc_maior |= consulta.tipo == "maior" && !usar_indice_tamanhos;
+        calc_vazias |= consulta.tipo == "vazias";
+        calc_pasta |= consulta.tipo == "pasta-mais-arquivos";
+        if (consulta.tipo == "extensao" && !usar_indice_extensoes)
+        {
+            extensoes.emplace(normalizarExtensao(consulta.argumento), extensoes.size());
+        }
+        if (consulta.tipo == "maiores" && !usar_indice_tamanhos)
+        {
+            limites.push_back(consulta.limite);
+        }
+    }
+    sort(limites.begin(), limites.end());
+    limites.erase(unique(limites.begin(), limites.end()), limites.end());
+
+    // Resultados de uma tarefa da travessia; combinados na ordem das tarefas
+    struct Parcial
+    {
+        int64_t max_tam = -1;
+        vector<uint32_t> maiores;
+        vector<uint32_t> vazias;
+        int max_arquivos = -1;
+        uint32_t pasta_mais = ArvoreArquivos::SEM_PAI;
+        vector<vector<uint32_t>> por_extensao;
+        vector<vector<uint32_t>> por_limite;
+        uint64_t visitados = 0;
+    };
+    int64_t max_tam = -1;
+    vector<uint32_t> maiores;
+    vector<uint32_t> vazias;
+    int max_arquivos = -1;
+    uint32_t pasta_mais = ArvoreArquivos::SEM_PAI;
+    vector<vector<uint32_t>> por_extensao(extensoes.size());
+    vector<vector<uint32_t>> por_limite(limites.size());
+    if (calc_maior || calc_vazias || calc_pasta || !extensoes.empty() || !limites.empty())
+    {
+        auto inicio_travessia = chrono::steady_clock::now();
+        auto parciais = arvore.percorrerEmParalelo<Parcial>(arvore.raiz(), num_threads, [&](uint32_t id, Parcial &p)
+                                                            {
+            p.visitados++;
+            if (arvore.ehArquivo(id))
+            {
+                int64_t tamanho = arvore.no(id).tamanho;
+                if (calc_maior && tamanho >= p.max_tam)
+                {
+                    if (tamanho > p.max_tam)
+                    {
+                        p.max_tam = tamanho;
+                        p.maiores.clear();
+                    }
+                    p.maiores.push_back(id);
+                }
+                if (!extensoes.empty())
+                {
+                    auto lista = extensoes.find(normalizarExtensao(extensao(arvore.nome(id))));
+                    if (lista != extensoes.end())
+                    {
+                        p.por_extensao.resize(extensoes.size());
+                        p.por_extensao[lista->second].push_back(id);
+                    }
+                }
+                for (size_t i = 0; i < limites.size() && limites[i] < tamanho; i++)
+                {
+                    p.por_limite.resize(limites.size());
+                    p.por_limite[i].push_back(id);
+                }
+                return;
+            }
+            IntervaloFilhos filhos = arvore.filhosDe(id);
+            if (calc_vazias && filhos.empty())
+            {
+                p.vazias.push_back(id);
+            }
+            if (calc_pasta)
+            {
+                int arquivos_diretos = 0;
+                for (uint32_t filho : filhos)
+                {
+                    arquivos_diretos += arvore.ehArquivo(filho) ? 1 : 0;
+                }
+                if (arquivos_diretos > p.max_arquivos)
+                {
+                    p.max_arquivos = arquivos_diretos;
+                    p.pasta_mais = id;
+                }
+            } });
+
+        // Combinação na ordem das tarefas (= pré-ordem): mesmos resultados e empates da travessia serial
+        uint64_t visitados = 0;
+        for (Parcial &p : parciais)
+        {
+            visitados += p.visitados;
+            if (p.max_tam > max_tam)
+            {
+                max_tam = p.max_tam;
+                maiores.clear();
+            }
+            if (p.max_tam == max_tam)
+            {
+                maiores.insert(maiores.end(), p.maiores.begin(), p.maiores.end());
+            }
+            vazias.insert(vazias.end(), p.vazias.begin(), p.vazias.end());
+            if (p.max_arquivos > max_arquivos)
+            {
+                max_arquivos = p.max_arquivos;
+                pasta_mais = p.pasta_mais;
+            }
+            for (size_t i = 0; i < p.por_extensao.size(); i++)
+            {
+                por_extensao[i].insert(por_extensao[i].end(), p.por_extensao[i].begin(), p.por_extensao[i].end());
+            }
+            for (size_t i = 0; i < p.por_limite.size(); i++)
+            {
+                por_limite[i].insert(por_limite[i].end(), p.por_limite[i].begin(), p.por_limite[i].end());
+            }
+        }
+        instrumentacao.registrarFase("travessia fundida", inicio_travessia, visitados);
+    }
+
+    size_t linhas = 0;
+    auto linha = [&](const string &tipo)
+    {
+        linhas++;
+        saida << "{\"consulta\":";
+        escreverJSON(saida, tipo);
+    };
+    bool ok = true;
+    for (const Consulta &consulta : consultas)
+    {
+        const string &tipo = consulta.tipo;
+        auto inicio_consulta = chrono::steady_clock::now();
+        linhas = 0;
+        if (tipo == "maior")
+        {
+            if (usar_indice_tamanhos)
+            {
+                maiores.clear();
+                auto topo = arvore.maioresArquivos(1);
+                max_tam = topo.empty() ? -1 : topo[0].second;
+                for (const auto &[id, tam] : topo.empty() ? topo : arvore.arquivosEntre(max_tam, max_tam))
+                {
+                    maiores.push_back(id);
+                }
+            }
+            sort(maiores.begin(), maiores.end()); // empates na ordem dos ids, com ou sem índice
+            for (uint32_t id : maiores)
+            {
+                linha(tipo);
+                saida << ",\"caminho\":";
+                escreverJSON(saida, arvore.caminho(id));
+                saida << ",\"tamanho\":" << max_tam << "}\n";
+            }
+        }
+        else if (tipo == "extensao")
+        {
+            vector<uint32_t> ids = usar_indice_extensoes ? arvore.idsPorExtensao(consulta.argumento)
+                                                         : por_extensao[extensoes.at(normalizarExtensao(consulta.argumento))];
+            sort(ids.begin(), ids.end()); // mesma ordem com ou sem índice
+            for (uint32_t id : ids)
+            {
+                linha(tipo);
+                saida << ",\"extensao\":";
+                escreverJSON(saida, consulta.argumento);
+                saida << ",\"caminho\":";
+                escreverJSON(saida, arvore.caminho(id));
+                saida << "}\n";
+            }
+        }
+        else if (tipo == "glob" || tipo == "regex")
+        {
+            PadraoNome padrao;
+            string erro;
+            padrao.compilar(consulta.argumento, tipo == "regex", erro); // já validado por interpretarConsulta
+            for (uint32_t id : arvore.idsPorPadrao(padrao))
+            {
+                linha(tipo);
+                saida << ",\"padrao\":";
+                escreverJSON(saida, consulta.argumento);
+                saida << ",\"caminho\":";
+                escreverJSON(saida, arvore.caminho(id));
+                saida << "}\n";
+            }
+        }
+        else if (tipo == "duplicados")
+        {
+            for (const ConjuntoDuplicados &conjunto : duplicados.conjuntos)
+            {
+                linha(tipo);
+                saida << ",\"tamanho\":" << conjunto.tamanho << ",\"recuperavel\":" << conjunto.recuperavel() << ",\"caminhos\":[";
+                for (size_t i = 0; i < conjunto.caminhos.size(); i++)
+                {
+                    saida << (i ? "," : "");
+                    escreverJSON(saida, conjunto.caminhos[i]);
+                }
+                saida << "]}\n";
+            }
+        }
+        else if (tipo == "vazias")
+        {
+            for (uint32_t id : vazias)
+            {
+                linha(tipo);
+                saida << ",\"caminho\":";
+                escreverJSON(saida, arvore.caminho(id));
+                saida << "}\n";
+            }
+        }
+        else if (tipo == "maiores")
+        {
+            int64_t n = consulta.limite;
+            vector<uint32_t> ids;
+            if (usar_indice_tamanhos)
+            {
+                for (const auto &[id, tam] : n == INT64_MAX ? vector<pair<uint32_t, int64_t>>() : arvore.arquivosEntre(n + 1, INT64_MAX))
+                {
+                    ids.push_back(id);
+                }
+            }
+            else
+            {
+                // Mesma ordem do índice: maiores primeiro, empates por id
+                ids = por_limite[lower_bound(limites.begin(), limites.end(), n) - limites.begin()];
+                sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b)
+                     { return OrdemTamanhoDecrescente()({arvore.no(a).tamanho, a}, {arvore.no(b).tamanho, b}); });
+            }
+            for (uint32_t id : ids)
+            {
+                linha(tipo);
+                saida << ",\"limite\":" << n << ",\"caminho\":";
+                escreverJSON(saida, arvore.caminho(id));
+                saida << ",\"tamanho\":" << arvore.no(id).tamanho << "}\n";
+            }
+        }
+        else if (tipo == "pasta-mais-arquivos")
+        {
+            if (pasta_mais != ArvoreArquivos::SEM_PAI)
+            {
+                linha(tipo);
+                saida << ",\"caminho\":";
+                escreverJSON(saida, arvore.caminho(pasta_mais));
+                saida << ",\"arquivos\":" << max_arquivos << "}\n";
+            }
+        }
+        else if (tipo == "html" || tipo == "html-recolhivel")
+        {
+            bool gerado = exportarHTML(arvore, consulta.argumento, tipo == "html-recolhivel");
+            ok &= gerado;
+            linha(tipo);
+            saida << ",\"arquivo\":";
+            escreverJSON(saida, consulta.argumento);
+            saida << ",\"ok\":" << (gerado ? "true" : "false") << "}\n";
+        }
+        instrumentacao.registrarConsulta(tipo, inicio_consulta, linhas);
+    }
+    return ok;
+}
+
+// Totais de uma comparação entre duas árvores
+struct ResumoDiferencas
+{
+    size_t adicionados = 0;       // arquivos e pastas que só existem na árvore nova
+    size_t removidos = 0;         // arquivos e pastas que só existem na árvore antiga
+    size_t alterados = 0;         // arquivos com tamanho diferente
+    size_t pastas_alteradas = 0;  // pastas presentes nas duas com hash diferente
+    int64_t delta = 0;            // diferença do tamanho total (nova - antiga)
+};
+
+// Compara duas árvores e escreve as diferenças em JSON, um objeto por linha
+// @param antiga: Árvore de referência (por exemplo, o snapshot de ontem)
+// @param nova: Árvore atual
+// @param saida: Escritor que recebe as linhas
+// @return Os totais da comparação
+// @note Os itens são pareados pelo nome dentro de cada pasta. Subárvores com o mesmo
+//       hash Merkle (nome, tipo, tamanhos e hashes dos filhos) são iguais e não são
+//       percorridas, então o custo acompanha a quantidade de mudanças (e o número de
+//       filhos das pastas alteradas), não o tamanho das árvores. As raízes são sempre
+//       comparadas pelo conteúdo, mesmo com nomes diferentes. Pastas adicionadas ou
+//       removidas saem em uma linha só, com os totais da subárvore. Os caminhos são
+//       relativos às raízes ("." é a própria raiz).
+// @example Saída:
+//          {"diferenca":"pasta","caminho":"logs","antes":1200,"depois":5400,"delta":4200}
+//          {"diferenca":"alterado","tipo":"arquivo","caminho":"logs/app.log","antes":1000,"depois":5200}
+//          {"diferenca":"adicionado","tipo":"pasta","caminho":"logs/2024","tamanho":0,"arquivos":0}
+static ResumoDiferencas compararArvores(const ArvoreArquivos &antiga, const ArvoreArquivos &nova, EscritorBuffer &saida)
+{
+    ResumoDiferencas resumo;
+    resumo.delta = nova.estatisticas(nova.raiz()).tamanho_total - antiga.estatisticas(antiga.raiz()).tamanho_total;
+    auto juntar = [](const string &prefixo, string_view nome)
+    {
+        return prefixo == "." ? string(nome) : juntarCaminho(prefixo, nome);
+    };
+    auto item = [&](const char *diferenca, const ArvoreArquivos &arvore, uint32_t id, const string &caminho)
+    {
+        const EstatisticasNo &est = arvore.estatisticas(id);
+        saida << "{\"diferenca\":\"" << diferenca << "\",\"tipo\":\"" << nomeTipo(arvore.no(id).tipo) << "\",\"caminho\":";
+        escreverJSON(saida, caminho);
+        saida << ",\"tamanho\":" << est.tamanho_total;
+        if (!arvore.ehArquivo(id))
+        {
+            saida << ",\"arquivos\":" << est.num_arquivos;
+        }
+        saida << "}\n";
+    };
+
+    // Filhos de uma pasta ordenados pelo nome, para o pareamento por intercalação
+    auto ordenados = [](const ArvoreArquivos &arvore, uint32_t pasta)
+    {
+        IntervaloFilhos filhos = arvore.filhosDe(pasta);
+        vector<uint32_t> ids(filhos.begin(), filhos.end());
+        sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b)
+             { return arvore.nome(a) < arvore.nome(b); });
+        return ids;
+    };
+
+    // Compara duas pastas de mesmo caminho cujos hashes diferem
+    auto compararPastas = [&](auto &&self, uint32_t a, uint32_t b, const string &caminho) -> void
+    {
+        resumo.pastas_alteradas++;
+        int64_t antes = antiga.estatisticas(a).tamanho_total, depois = nova.estatisticas(b).tamanho_total;
+        if (antes != depois)
+        {
+            saida << "{\"diferenca\":\"pasta\",\"caminho\":";
+            escreverJSON(saida, caminho);
+            saida << ",\"antes\":" << antes << ",\"depois\":" << depois << ",\"delta\":" << depois - antes << "}\n";
+        }
+        vector<uint32_t> filhos_a = ordenados(antiga, a), filhos_b = ordenados(nova, b);
+        size_t i = 0, j = 0;
+        while (i < filhos_a.size() || j < filhos_b.size())
+        {
+            int ordem = (i == filhos_a.size())   ? 1
+                        : (j == filhos_b.size()) ? -1
+                                                 : antiga.nome(filhos_a[i]).compare(nova.nome(filhos_b[j]));
+            if (ordem < 0)
+            {
+                resumo.removidos++;
+                item("removido", antiga, filhos_a[i], juntar(caminho, antiga.nome(filhos_a[i])));
+                i++;
+                continue;
+            }
+            if (ordem > 0)
+            {
+                resumo.adicionados++;
+                item("adicionado", nova, filhos_b[j], juntar(caminho, nova.nome(filhos_b[j])));
+                j++;
+                continue;
+            }
+            uint32_t fa = filhos_a[i++], fb = filhos_b[j++];
+            if (antiga.estatisticas(fa).hash == nova.estatisticas(fb).hash)
+            {
+                continue; // subárvore idêntica
+            }
+            string caminho_filho = juntar(caminho, nova.nome(fb));
+            if (antiga.ehArquivo(fa) != nova.ehArquivo(fb))
+            {
+                resumo.removidos++;
+                item("removido", antiga, fa, caminho_filho);
+                resumo.adicionados++;
+                item("adicionado", nova, fb, caminho_filho);
+            }
+            else if (nova.ehArquivo(fb))
+            {
+                resumo.alterados++;
+                saida << "{\"diferenca\":\"alterado\",\"tipo\":\"arquivo\",\"caminho\":";
+                escreverJSON(saida, caminho_filho);
+                saida << ",\"antes\":" << antiga.no(fa).tamanho << ",\"depois\":" << nova.no(fb).tamanho << "}\n";
+            }
+            else
+            {
+                self(self, fa, fb, caminho_filho);
+            }
+        }
+    };
+
+    auto inicio = chrono::steady_clock::now();
+    uint32_t raiz_a = antiga.raiz(), raiz_b = nova.raiz();
+    if (antiga.hashConteudo(raiz_a) != nova.hashConteudo(raiz_b)) // as raízes podem ter nomes diferentes
+    {
+        compararPastas(compararPastas, raiz_a, raiz_b, ".");
+    }
+    instrumentacao.registrarFase("comparacao", inicio, resumo.pastas_alteradas);
+    return resumo;
+}
+
+// Carrega a árvore de referência de uma comparação
+// @param origem: Pasta a varrer ou arquivo de snapshot a abrir
+// @param num_threads: Workers da varredura (quando "origem" é uma pasta)
+// @param uso_disco: Modo de tamanho da varredura (o mesmo da árvore comparada)
+// @param arvore: Recebe a árvore carregada
+// @param erro: Recebe a mensagem quando o snapshot não pode ser aberto
+// @return false se "origem" não é uma pasta nem um snapshot válido
+static bool carregarReferencia(const string &origem, unsigned num_threads, bool uso_disco, ArvoreArquivos &arvore, string &erro)
+{
+    error_code e;
+    if (fs::is_directory(origem, e))
+    {
+        arvore = carregarArvore(origem, num_threads, uso_disco);
+        return true;
+    }
+    return arvore.abrirSnapshot(origem, erro);
+}
+
+// Sinal recebido pelo servidor de consultas (SIGINT/SIGTERM): encerra como o comando "encerrar"
+static volatile sig_atomic_t sinal_encerrar = 0;
+
+// Servidor de consultas residente em um socket Unix local (modo --servir)
+// @note Protocolo de texto, uma requisição por linha. A requisição é uma consulta no
+//       formato de -c ("maior", "extensao=.log", "maiores=N", "glob=...", ...) ou um
+//       comando: "resumo" (totais da árvore), "atualizar" (relista as pastas que mudaram
+//       no disco) ou "encerrar". A resposta são as mesmas linhas JSON de -c, terminadas
+//       por {"fim":true,"ms":X}; uma requisição inválida responde {"erro":...} antes do fim.
+//       Cada conexão é atendida por um thread e as consultas usam a trava de leitura da
+//       árvore, então vários clientes consultam ao mesmo tempo; "atualizar" e o
+//       monitoramento (--monitorar) usam a trava de escrita.
+// @example printf 'maior\nextensao=.log\n' | nc -U /tmp/arvore.sock
+class ServidorConsultas
 {
 public:
+    // @param arvore: Árvore consultada
+    // @param trava: Trava que protege a árvore (a mesma do monitoramento)
+    // @param num_threads: Threads de cada consulta (0 = uma por núcleo)
+    // @param monitor: Monitoramento que observa as pastas novas de "atualizar" (nullptr se não houver)
+    ServidorConsultas(ArvoreArquivos &arvore, shared_mutex &trava, unsigned num_threads, MonitorArvore *monitor)
+        : arvore(arvore), trava(trava), num_threads(num_threads), monitor(monitor) {}
+
+    ~ServidorConsultas() { fechar(); }
+
+    // Cria o socket e começa a aceitar conexões (um socket de uma execução anterior
+    // que não responde mais é substituído)
+    // @param caminho: Caminho do socket no sistema de arquivos
+    // @param erro: Recebe a descrição do problema quando o socket não pode ser criado
+    // @return true se o servidor está escutando
+    bool iniciar(const string &caminho, string &erro)
+    {
+        sockaddr_un endereco{};
+        if (caminho.size() >= sizeof(endereco.sun_path))
+        {
+            erro = "caminho do socket longo demais";
+            return false;
+        }
+        endereco.sun_family = AF_UNIX;
+        memcpy(endereco.sun_path, caminho.c_str(), caminho.size() + 1);
+
+        struct stat info;
+        if (lstat(caminho.c_str(), &info) == 0)
+        {
+            if (!S_ISSOCK(info.st_mode))
+            {
+                erro = "o caminho existe e nao e um socket";
+                return false;
+            }
+            int teste = socket(AF_UNIX, SOCK_STREAM, 0);
+            bool em_uso = teste >= 0 && connect(teste, reinterpret_cast<sockaddr *>(&endereco), sizeof(endereco)) == 0;
+            if (teste >= 0)
+            {
+                close(teste);
+            }
+            if (em_uso)
+            {
+                erro = "ja existe um servidor neste socket";
+                return false;
+            }
+            unlink(caminho.c_str());
+        }
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) < 0 ||
+            ::bind(fd, reinterpret_cast<sockaddr *>(&endereco), sizeof(endereco)) < 0 || listen(fd, SOMAXCONN) < 0)
+        {
+            erro = strerror(errno);
+            fechar();
+            return false;
+        }
+        caminho_socket = caminho;
+        signal(SIGPIPE, SIG_IGN); // cliente que fecha antes da resposta vira erro de escrita
+        return true;
+    }
+
+    // Aceita e atende conexões até o comando "encerrar" ou SIGINT/SIGTERM
+    void executar()
+    {
+        auto tratarSinal = [](int) { sinal_encerrar = 1; };
+        signal(SIGINT, tratarSinal);
+        signal(SIGTERM, tratarSinal);
+        while (executando && !sinal_encerrar)
+        {
+            recolherConexoes();
+            pollfd espera{fd, POLLIN, 0};
+            if (poll(&espera, 1, 200) <= 0)
+            {
+                continue;
+            }
+            int cliente = accept(fd, nullptr, nullptr);
+            if (cliente < 0)
+            {
+                continue;
+            }
+            fcntl(cliente, F_SETFD, FD_CLOEXEC);
+            Conexao &conexao = conexoes.emplace_back();
+            conexao.fd = cliente;
+            conexao.atendimento = thread(&ServidorConsultas::atender, this, ref(conexao));
+        }
+        executando = false;
+        fechar();
+
+        // Desbloqueia as leituras dos clientes ainda conectados e espera os threads
+        for (Conexao &conexao : conexoes)
+        {
+            shutdown(conexao.fd, SHUT_RDWR);
+        }
+        for (Conexao &conexao : conexoes)
+        {
+            conexao.atendimento.join();
+            close(conexao.fd);
+        }
+        conexoes.clear();
+    }
+
+    size_t requisicoesAtendidas() const { return requisicoes; }
+
+private:
+    // Tamanho máximo de uma requisição; linhas maiores encerram a conexão
+    static constexpr size_t MAX_REQUISICAO = 64 * 1024;
+
+    void fechar()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        if (!caminho_socket.empty())
+        {
+            unlink(caminho_socket.c_str());
+            caminho_socket.clear();
+        }
+    }
+
+    // Uma conexão aceita; o descritor só é fechado depois do join, pelo thread que aceita
+    struct Conexao
+    {
+        int fd = -1;
+        thread atendimento;
+        atomic<bool> terminou{false};
+    };
+
+    // Espera (join) os threads das conexões já encerradas, para que um servidor de
+    // longa duração não acumule um thread terminado por conexão atendida
+    void recolherConexoes()
+    {
+        for (auto it = conexoes.begin(); it != conexoes.end();)
+        {
+            if (!it->terminou)
+            {
+                ++it;
+                continue;
+            }
+            it->atendimento.join();
+            close(it->fd);
+            it = conexoes.erase(it);
+        }
+    }
+
+    // Lê as requisições de uma conexão, uma por linha, e responde cada uma
+    void atender(Conexao &conexao)
+    {
+        const int cliente = conexao.fd;
+        FILE *destino = fdopen(dup(cliente), "w");
+        if (destino)
+        {
+            EscritorBuffer saida(destino, 64 * 1024);
+            string pendente;
+            char bloco[4096];
+            bool aberta = true;
+            while (aberta && executando)
+            {
+                ssize_t lidos = read(cliente, bloco, sizeof(bloco));
+                if (lidos < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (lidos <= 0)
+                {
+                    break;
+                }
+                pendente.append(bloco, lidos);
+                size_t inicio = 0, quebra;
+                while (aberta && (quebra = pendente.find('\n', inicio)) != string::npos)
+                {
+                    string requisicao = pendente.substr(inicio, quebra - inicio);
+                    inicio = quebra + 1;
+                    if (!requisicao.empty() && requisicao.back() == '\r')
+                    {
+                        requisicao.pop_back();
+                    }
+                    if (!requisicao.empty())
+                    {
+                        responder(requisicao, saida);
+                        saida.descarregar();
+                        aberta = fflush(destino) == 0 && !saida.falhou();
+                    }
+                }
+                pendente.erase(0, inicio);
+                aberta = aberta && pendente.size() <= MAX_REQUISICAO;
+            }
+            saida.descarregar();
+            fclose(destino);
+        }
+        conexao.terminou = true;
+    }
+
+    // Executa uma requisição e escreve a resposta completa (terminada pela linha "fim")
+    void responder(const string &requisicao, EscritorBuffer &saida)
+    {
+        auto inicio = chrono::steady_clock::now();
+        Consulta consulta;
+        if (requisicao == "encerrar")
+        {
+            executando = false;
+        }
+        else if (requisicao == "resumo")
+        {
+            shared_lock<shared_mutex> leitura(trava);
+            const EstatisticasNo &est = arvore.estatisticas(arvore.raiz());
+            saida << "{\"resumo\":";
+            escreverJSON(saida, arvore.caminhoRaiz());
+            saida << ",\"arquivos\":" << est.num_arquivos << ",\"pastas\":" << est.num_pastas
+                  << ",\"tamanho\":" << est.tamanho_total << ",\"profundidade\":" << est.profundidade_max << "}\n";
+        }
+        else if (requisicao == "atualizar")
+        {
+            // O conteúdo das pastas novas é varrido depois, fora da trava de escrita
+            vector<uint32_t> pastas_novas;
+            size_t verificadas, relistadas;
+            {
+                unique_lock<shared_mutex> escrita(trava);
+                verificadas = arvore.estatisticas(arvore.raiz()).num_pastas + 1;
+                relistadas = revalidarPastas(arvore, arvore.raiz(), num_threads, pastas_novas);
+            }
+            recarregarPastas(arvore, trava, pastas_novas, num_threads, monitor);
+            saida << "{\"atualizar\":true,\"verificadas\":" << verificadas << ",\"relistadas\":" << relistadas
+                  << ",\"novas\":" << pastas_novas.size() << "}\n";
+        }
+        else if (interpretarConsulta(requisicao, consulta))
+        {
+            shared_lock<shared_mutex> leitura(trava);
+            if (!executarConsultas(arvore, {consulta}, saida, num_threads, &leitura))
+            {
+                saida << "{\"erro\":\"falha na exportacao\",\"requisicao\":";
+                escreverJSON(saida, requisicao);
+                saida << "}\n";
+            }
+        }
+        else
+        {
+            saida << "{\"erro\":\"requisicao invalida\",\"requisicao\":";
+            escreverJSON(saida, requisicao);
+            saida << "}\n";
+        }
+        requisicoes++;
+        double ms = instrumentacao.registrarConsulta("servidor", inicio, 1);
+        char tempo[32];
+        snprintf(tempo, sizeof(tempo), "%.3f", ms);
+        saida << "{\"fim\":true,\"ms\":" << string_view(tempo) << "}\n";
+    }
+
+    ArvoreArquivos &arvore;
+    shared_mutex &trava;
+    unsigned num_threads;
+    MonitorArvore *monitor;
+    int fd = -1;
+    string caminho_socket;
+    atomic<bool> executando{true};
+    atomic<size_t> requisicoes{0};
+    list<Conexao> conexoes; // só o thread que aceita mexe na lista
+};
+
+// Envia requisições a um servidor --servir e copia as respostas para a saída padrão
+// @param caminho: Socket do servidor
+// @param requisicoes: Requisições, uma por linha do protocolo
+// @return 0 se todas foram respondidas sem erro, 1 se alguma falhou
+static int consultarServidor(const string &caminho, const vector<string> &requisicoes)
+{
+    sockaddr_un endereco{};
+    if (caminho.size() >= sizeof(endereco.sun_path))
+    {
+        cerr << "Caminho do socket longo demais" << endl;
+        return 1;
+    }
+    endereco.sun_family = AF_UNIX;
+    memcpy(endereco.sun_path, caminho.c_str(), caminho.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&endereco), sizeof(endereco)) < 0)
+    {
+        cerr << "Erro ao conectar em \"" << caminho << "\": " << strerror(errno) << endl;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+
+    string envio;
+    for (const string &requisicao : requisicoes)
+    {
+        envio += requisicao;
+        envio += '\n';
+    }
+    signal(SIGPIPE, SIG_IGN);
+    for (size_t enviados = 0; enviados < envio.size();)
+    {
+        ssize_t n = write(fd, envio.data() + enviados, envio.size() - enviados);
+        if (n <= 0)
+        {
+            cerr << "Erro ao enviar requisicoes: " << strerror(errno) << endl;
+            close(fd);
+            return 1;
+        }
+        enviados += n;
+    }
+
+    // Uma linha "fim" por requisição; as demais são o resultado
+    int codigo = 0;
+    size_t respondidas = 0;
+    string pendente;
+    char bloco[1 << 16];
+    EscritorBuffer saida(stdout);
+    while (respondidas < requisicoes.size())
+    {
+        ssize_t lidos = read(fd, bloco, sizeof(bloco));
+        if (lidos < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (lidos <= 0)
+        {
+            break;
+        }
+        pendente.append(bloco, lidos);
+        size_t inicio = 0, quebra;
+        while ((quebra = pendente.find('\n', inicio)) != string::npos)
+        {
+            string_view linha(pendente.data() + inicio, quebra - inicio);
+            inicio = quebra + 1;
+            if (linha.rfind("{\"fim\":", 0) == 0)
+            {
+                respondidas++;
+            }
+            else if (linha.rfind("{\"erro\":", 0) == 0)
+            {
+                cerr << linha << endl;
+                codigo = 1;
+            }
+            else
+            {
+                saida << linha << '\n';
+            }
+        }
+        pendente.erase(0, inicio);
+    }
+    close(fd);
+    saida.descarregar();
+    if (respondidas < requisicoes.size())
+    {
+        cerr << "Conexao encerrada pelo servidor antes de todas as respostas" << endl;
+        codigo = 1;
+    }
+    return codigo || saida.falhou() ? 1 : 0;
+}
+
+// Parâmetros do gerador de árvores sintéticas usado por --bench
+struct ConfigBench
+{
+    vector<uint64_t> entradas{10000, 1000000}; // tamanhos de árvore a medir (um ciclo por valor)
+    unsigned ramificacao = 16;                 // média de itens por pasta
+    double fracao_pastas = 0.2;                // chance de um item ser pasta (abaixo do limite de profundidade)
+    unsigned profundidade = 0;                 // níveis máximos (0 = o mínimo que comporta as entradas)
+    int64_t tamanho_max = 16 << 20;            // maior tamanho de arquivo gerado (distribuição log-uniforme)
+    vector<pair<string, unsigned>> extensoes{{".txt", 4}, {".log", 2}, {".jpg", 2}, {".cpp", 1}, {".h", 1}, {"", 1}};
+    uint64_t semente = 42;
+    string disco; // pasta onde a variante em disco é criada (vazio = só em memória)
+};
+
+// Gerador pseudoaleatório splitmix64: a mesma semente gera a mesma árvore em qualquer plataforma
+struct GeradorAleatorio
+{
+    uint64_t estado;
+
+    uint64_t proximo()
+    {
+        uint64_t z = (estado += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    // Número em [0, limite)
+    uint64_t ate(uint64_t limite) { return limite == 0 ? 0 : proximo() % limite; }
+    // Número em [0, 1)
+    double fracao() { return (proximo() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// Lê uma quantidade com sufixo opcional K, M ou G (ex: "10K", "16M")
+// @param base: Multiplicador de cada sufixo (1000 para contagens, 1024 para bytes)
+// @param maximo: Maior valor aceito (o do tipo que vai guardar a quantidade)
+// @return false se o texto não é um número válido ou se o valor, já multiplicado
+//         pelo sufixo, passa de "maximo"
+static bool lerQuantidade(const string &texto, uint64_t base, uint64_t &valor, uint64_t maximo = UINT64_MAX)
+{
+    const char *fim = texto.data() + texto.size();
+    auto [resto, erro] = from_chars(texto.data(), fim, valor);
+    if (erro != errc() || resto == texto.data())
+    {
+        return false;
+    }
+    if (resto == fim)
+    {
+        return valor <= maximo;
+    }
+    if (resto + 1 != fim)
+    {
+        return false;
+    }
+    // Cada multiplicação é conferida antes, para que "20000000000G" não dê a volta
+    auto multiplicar = [&]
+    {
+        if (valor > maximo / base)
+        {
+            return false;
+        }
+        valor *= base;
+        return true;
+    };
+    switch (toupper(static_cast<unsigned char>(*resto)))
+    {
+    case 'G':
+        return multiplicar() && multiplicar() && multiplicar();
+    case 'M':
+        return multiplicar() && multiplicar();
+    case 'K':
+        return multiplicar();
+    }
+    return false;
+}
+
+// Interpreta a especificação do --bench: "chave=valor,chave=valor,..." ou só a quantidade de entradas
+// Chaves: entradas=10K/1M/10M, ramificacao=N, pastas=FRACAO, profundidade=N, tamanho_max=16M,
+//         extensoes=.txt:4/.log:2/:1 (peso de cada extensão; vazia = sem extensão),
+//         semente=N, disco=PASTA
+// @return false se alguma chave ou valor é inválido
+static bool interpretarBench(const string &espec, ConfigBench &config)
+{
+    size_t inicio = 0;
+    while (inicio <= espec.size())
+    {
+        size_t virgula = espec.find(',', inicio);
+        string item = espec.substr(inicio, virgula == string::npos ? string::npos : virgula - inicio);
+        inicio = (virgula == string::npos) ? espec.size() + 1 : virgula + 1;
+        size_t igual = item.find('=');
+        string chave = (igual == string::npos) ? "entradas" : item.substr(0, igual);
+        string valor = (igual == string::npos) ? item : item.substr(igual + 1);
+
+        // Divide listas separadas por '/'
+        vector<string> partes;
+        for (size_t p = 0; p <= valor.size();)
+        {
+            size_t barra = valor.find('/', p);
+            partes.push_back(valor.substr(p, barra == string::npos ? string::npos : barra - p));
+            p = (barra == string::npos) ? valor.size() + 1 : barra + 1;
+        }
+
+        uint64_t numero = 0;
+        if (chave == "entradas")
+        {
+            config.entradas.clear();
+            for (const string &parte : partes)
+            {
+                if (!lerQuantidade(parte, 1000, numero, ArvoreArquivos::SEM_PAI - 1) || numero == 0)
+                {
+                    return false;
+                }
+                config.entradas.push_back(numero);
+            }
+        }
+        else if (chave == "ramificacao" && lerQuantidade(valor, 1000, numero, UINT_MAX) && numero > 0)
+        {
+            config.ramificacao = static_cast<unsigned>(numero);
+        }
+        else if (chave == "profundidade" && lerQuantidade(valor, 1000, numero, UINT_MAX))
+        {
+            config.profundidade = static_cast<unsigned>(numero);
+        }
+        else if (chave == "tamanho_max" && lerQuantidade(valor, 1024, numero, INT64_MAX) && numero > 0)
+        {
+            config.tamanho_max = static_cast<int64_t>(numero);
+        }
+        else if (chave == "semente" && lerQuantidade(valor, 1000, numero))
+        {
+            config.semente = numero;
+        }
+        else if (chave == "pastas")
+        {
+            char *fim;
+            config.fracao_pastas = strtod(valor.c_str(), &fim);
+            if (*fim != '\0' || config.fracao_pastas < 0 || config.fracao_pastas > 1)
+            {
+                return false;
+            }
+        }
+        else if (chave == "extensoes")
+        {
+            config.extensoes.clear();
+            for (const string &parte : partes)
+            {
+                size_t dois_pontos = parte.rfind(':');
+                uint64_t peso = 1;
+                if (dois_pontos != string::npos && !lerQuantidade(parte.substr(dois_pontos + 1), 1000, peso, UINT_MAX))
+                {
+                    return false;
+                }
+                config.extensoes.emplace_back(parte.substr(0, dois_pontos), static_cast<unsigned>(peso));
+            }
+        }
+        else if (chave == "disco" && !valor.empty())
+        {
+            config.disco = valor;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gera uma árvore sintética em memória, já no layout compacto
+// @param config: Formato da árvore (ramificação, profundidade, tamanhos, extensões, semente)
+// @param entradas: Quantidade de arquivos e pastas a gerar (além da raiz)
+// @param caminho_raiz: Caminho atribuído à raiz (base dos caminhos reconstruídos)
+// @return A árvore gerada, sem estatísticas nem índices (quem chama mede essas fases à parte)
+// @note A geração é em largura, como a linearização de carregarArvore: cada pasta
+//       recebe de 0 a 2×ramificacao itens (média "ramificacao"), cada item é pasta com
+//       probabilidade "fracao_pastas" e os tamanhos seguem uma distribuição
+//       log-uniforme até tamanho_max (muitos arquivos pequenos, poucos grandes).
+//       Pastas sorteadas sem itens ficam vazias, como em uma árvore real.
+static ArvoreArquivos gerarArvoreSintetica(const ConfigBench &config, uint64_t entradas, const string &caminho_raiz)
+{
+    GeradorAleatorio aleatorio{config.semente};
+    unsigned profundidade = config.profundidade;
+    if (profundidade == 0)
+    {
+        // Menor profundidade cuja capacidade esperada é o dobro das entradas pedidas
+        double pastas_por_nivel = 1, capacidade = 0;
+        double crescimento = config.ramificacao * config.fracao_pastas;
+        while (capacidade < 2.0 * entradas && profundidade < 64)
+        {
+            capacidade += pastas_por_nivel * config.ramificacao;
+            pastas_por_nivel *= crescimento;
+            profundidade++;
+        }
+    }
+    unsigned peso_total = 0;
+    for (const auto &[ext, peso] : config.extensoes)
+    {
+        peso_total += peso;
+    }
+    unsigned bits_max = 0; // tamanhos sorteados ficam abaixo de 2^bits_max <= tamanho_max
+    while (bits_max < 62 && (int64_t(2) << bits_max) <= config.tamanho_max)
+    {
+        bits_max++;
+    }
+
+    ArvoreArquivos arvore(fs::path(caminho_raiz).filename().string(), caminho_raiz);
+    arvore.reservar(entradas + 1, entradas * 12);
+    deque<pair<uint32_t, unsigned>> pendentes{{arvore.raiz(), 0}}; // (pasta, nível)
     string nome;
-    string tipo;  // "arquivo" ou "pasta"
-    long tamanho; // em bytes (0 para pastas)
-    vector<FileNode> filhos;
-    string caminho_completo;
+    while (!pendentes.empty() && arvore.tamanho() <= entradas)
+    {
+        auto [pai, nivel] = pendentes.front();
+        pendentes.pop_front();
+        uint64_t restantes = entradas + 1 - arvore.tamanho();
+        uint32_t quantidade = static_cast<uint32_t>(min<uint64_t>(aleatorio.ate(2ull * config.ramificacao + 1), restantes));
+        uint32_t primeiro = static_cast<uint32_t>(arvore.tamanho());
+        for (uint32_t i = 0; i < quantidade; i++)
+        {
+            if (nivel + 1 < profundidade && aleatorio.fracao() < config.fracao_pastas)
+            {
+                nome = "pasta_" + to_string(i);
+                pendentes.emplace_back(arvore.adicionarNo(nome, TipoNo::Pasta, 0, pai), nivel + 1);
+                continue;
+            }
+            unsigned sorteio = static_cast<unsigned>(aleatorio.ate(peso_total));
+            const string *ext = &config.extensoes.back().first;
+            for (const auto &[candidata, peso] : config.extensoes)
+            {
+                if (sorteio < peso)
+                {
+                    ext = &candidata;
+                    break;
+                }
+                sorteio -= peso;
+            }
+            unsigned bits = static_cast<unsigned>(aleatorio.ate(bits_max + 1));
+            int64_t tamanho = bits == 0 ? 0 : (int64_t(1) << (bits - 1)) + static_cast<int64_t>(aleatorio.ate(uint64_t(1) << (bits - 1)));
+            nome = "arq_" + to_string(i) + *ext;
+            arvore.adicionarNo(nome, TipoNo::Arquivo, tamanho, pai);
+        }
+        arvore.definirFilhos(pai, primeiro, quantidade);
+    }
+    if (arvore.tamanho() <= entradas)
+    {
+        cerr << "Aviso: a arvore sintetica parou em " << arvore.tamanho() - 1 << " entradas"
+             << " (aumente ramificacao, pastas ou profundidade)" << endl;
+    }
+    return arvore;
+}
 
-    // Construtor: Inicializa um nó da árvore com nome, tipo ("arquivo" ou "pasta") e tamanho
-    // @param nome: Nome do arquivo ou pasta
-    // @param tipo: Tipo do nó ("arquivo" ou "pasta")
-    // @param tamanho: Tamanho em bytes (0 por padrão, usado principalmente para arquivos)
-    FileNode(const string &nome, const string &tipo, long tamanho = 0, const string &caminho = "")
-        : nome(nome), tipo(tipo), tamanho(tamanho), caminho_completo(caminho) {}
+// Cria no disco a estrutura de uma árvore sintética
+// @param arvore: Árvore gerada por gerarArvoreSintetica (a raiz aponta para a pasta de destino)
+// @param erro: Recebe a descrição do problema quando a gravação falha
+// @return true se todas as pastas e arquivos foram criados
+// @note Os arquivos são esparsos (ftruncate): têm o tamanho lógico gerado sem ocupar
+//       o espaço correspondente, então mesmo a árvore de 10M entradas cabe em disco.
+static bool gravarArvoreSintetica(const ArvoreArquivos &arvore, string &erro)
+{
+    if (mkdir(arvore.caminhoRaiz().c_str(), 0755) != 0)
+    {
+        erro = arvore.caminhoRaiz() + ": " + strerror(errno);
+        return false;
+    }
+    for (uint32_t id = 1; id < arvore.tamanho(); id++)
+    {
+        string destino = arvore.caminho(id);
+        if (!arvore.ehArquivo(id))
+        {
+            if (mkdir(destino.c_str(), 0755) != 0)
+            {
+                erro = destino + ": " + strerror(errno);
+                return false;
+            }
+            continue;
+        }
+        int fd = open(destino.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0 || ftruncate(fd, arvore.no(id).tamanho) != 0)
+        {
+            erro = destino + ": " + strerror(errno);
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            return false;
+        }
+        close(fd);
+    }
+    return true;
+}
 
-    // Adiciona um nó filho (arquivo ou pasta) ao nó atual
-    // @param filho: Nó a ser adicionado como filho
-    void adicionarFilho(const FileNode &filho)
+// Confere o trecho fixo (PadraoNome::literal) de padrões com classes, escapes e
+// repetições: todo nome aceito pelo glob ou pela regex precisa contê-lo, senão a
+// busca no bloco de nomes descartaria um resultado que o casamento completo aceita
+// @return Quantidade de casos divergentes (cada um é relatado em cerr)
+static size_t conferirLiteraisPadroes()
+{
+    struct Caso
     {
-        filhos.push_back(filho);
+        const char *padrao;
+        bool eh_regex;
+        const char *nome;
+    };
+    static const Caso casos[] = {
+        {"^[\\]a]x$", true, "ax"},     {"^[\\]a]x$", true, "]x"},    {"[\\]]b", true, "]b"},
+        {"a[^\\]]c", true, "abc"},     {"x\\x41y", true, "xAy"},     {"\\d+px", true, "12px"},
+        {"foo(bar)?baz", true, "foobaz"}, {"ab{2}c", true, "abbc"}, {"ab+c", true, "abbbc"},
+        {"[]]ab*", false, "]abc"},     {"[!]]z*", false, "qz1"},     {"*[a-c]log", false, "blog"},
+        {"[[]x?", false, "[xy"},       {"a[b", false, "a[b"},
+    };
+    size_t divergentes = 0;
+    for (const Caso &caso : casos)
+    {
+        PadraoNome padrao;
+        string erro;
+        bool aceito = padrao.compilar(caso.padrao, caso.eh_regex, erro) && padrao.corresponde(caso.nome);
+        if (!aceito || string_view(caso.nome).find(padrao.literal) == string_view::npos)
+        {
+            cerr << "Aviso: padrao \"" << caso.padrao << "\" e nome \"" << caso.nome << "\" divergem (literal \""
+                 << padrao.literal << "\")" << endl;
+            divergentes++;
+        }
     }
+    return divergentes;
+}
 
-    // Retorna o número de filhos diretos (não recursivo) do nó atual
-    // @return O número total de nós filhos imediatos (arquivos e pastas)
-    // @note Este método conta apenas os filhos diretos, não incluindo subpastas
-    //       ou arquivos dentro das subpastas. Para uma contagem completa de
-    //       todos os itens na árvore, seria necessário um método recursivo.
-    // @see calcularTamanhoTotal() para um exemplo de método recursivo
-    int contarFilhos() const
+// Executa o benchmark: para cada tamanho pedido gera a árvore sintética e mede
+// construção, consultas, exibição em texto, exportação HTML e snapshot
+// @param config: Parâmetros do gerador e tamanhos a medir
+// @param num_threads: Workers da varredura (variante em disco)
+// @return 0 em caso de sucesso, 1 se a variante em disco ou a conferência dos padrões falhou
+// @note Cada fase imprime uma linha com o tempo, a quantidade de resultados, a vazão
+//       (entradas da árvore por segundo) e o pico de memória residente até ali. Como o
+//       pico só cresce, o valor logo após a construção é o custo da árvore em si.
+//       A variante em disco é medida com o cache do sistema quente (logo após a criação).
+// @example ./main --bench entradas=10K/1M/10M,ramificacao=32,disco=/tmp/bench
+static int executarBench(const ConfigBench &config, unsigned num_threads)
+{
+    string temporaria = (fs::temp_directory_path() / ("arvore_bench_" + to_string(getpid()))).string();
+    int resultado = conferirLiteraisPadroes() == 0 ? 0 : 1;
+    for (uint64_t entradas : config.entradas)
     {
-        return filhos.size();
+        cout << "\n== " << entradas << " entradas (ramificacao " << config.ramificacao << ", pastas "
+             << config.fracao_pastas << ", semente " << config.semente << ") ==\n";
+        cout << "Fase                          Tempo (ms)   Resultados    Entradas/s   Pico RSS (MB)\n";
+        double total_nos = 0;
+        auto medir = [&](const string &fase, auto &&executar)
+        {
+            auto inicio = chrono::steady_clock::now();
+            size_t resultados = executar();
+            double segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+            char linha[160];
+            snprintf(linha, sizeof(linha), "%-28s %11.2f %12zu %13.0f %15.1f\n", fase.c_str(), segundos * 1000,
+                     resultados, segundos > 0 ? total_nos / segundos : 0.0, picoMemoriaKB() / 1024.0);
+            cout << linha << flush;
+        };
+
+        string raiz = config.disco.empty() ? "/arvore_sintetica"
+                                           : (fs::absolute(config.disco) / ("arvore_" + to_string(entradas))).string();
+        ArvoreArquivos arvore;
+        medir("geracao", [&]
+              { arvore = gerarArvoreSintetica(config, entradas, raiz); total_nos = arvore.tamanho(); return arvore.tamanho(); });
+        medir("estatisticas", [&]
+              { arvore.recalcularSubarvore(arvore.raiz()); return arvore.tamanho(); });
+        medir("indice extensoes", [&]
+              { arvore.garantirIndiceExtensoes(); return arvore.tamanho(); });
+        medir("indice tamanhos", [&]
+              { arvore.garantirIndiceTamanhos(); return arvore.tamanho(); });
+
+        if (!config.disco.empty())
+        {
+            error_code existe;
+            if (fs::exists(raiz, existe))
+            {
+                cout << "(reutilizando " << raiz << ", criada anteriormente)\n";
+            }
+            else
+            {
+                string erro;
+                bool gravou = true;
+                fs::create_directories(config.disco, existe);
+                medir("gravacao em disco", [&]
+                      { gravou = gravarArvoreSintetica(arvore, erro); return arvore.tamanho(); });
+                if (!gravou)
+                {
+                    cerr << "Erro ao criar a arvore em disco: " << erro << endl;
+                    resultado = 1;
+                    continue;
+                }
+            }
+            ArvoreArquivos lida;
+            medir("varredura (carregarArvore)", [&]
+                  { lida = carregarArvore(raiz, num_threads); return lida.tamanho(); });
+            const EstatisticasNo &esperado = arvore.estatisticas(arvore.raiz());
+            const EstatisticasNo &obtido = lida.estatisticas(lida.raiz());
+            if (obtido.tamanho_total != esperado.tamanho_total || obtido.num_arquivos != esperado.num_arquivos ||
+                obtido.num_pastas != esperado.num_pastas)
+            {
+                cerr << "Aviso: a varredura de " << raiz << " difere da arvore gerada" << endl;
+            }
+        }
+
+        const uint32_t raiz_id = arvore.raiz();
+        const int64_t limiar = config.tamanho_max / 2;
+        medir("maior arquivo (DFS)", [&]
+              { long max_tam = -1; vector<string> caminhos; arvore.encontraMaiorArquivo(raiz_id, max_tam, caminhos); return caminhos.size(); });
+        medir("maior arquivo (paralelo)", [&]
+              { long max_tam = -1; vector<string> caminhos; arvore.encontraMaiorArquivo(raiz_id, max_tam, caminhos, num_threads); return caminhos.size(); });
+        medir("maior arquivo (indice)", [&]
+              { return arvore.maioresArquivos(1).size(); });
+        medir("extensao .txt (indice)", [&]
+              { vector<string> arquivos; arvore.buscaPorExtensao(".txt", arquivos); return arquivos.size(); });
+        medir("pastas vazias (DFS)", [&]
+              { vector<string> vazias; arvore.encontraPastasVazias(raiz_id, vazias); return vazias.size(); });
+        medir("pastas vazias (paralelo)", [&]
+              { vector<string> vazias; arvore.encontraPastasVazias(raiz_id, vazias, num_threads); return vazias.size(); });
+        medir("maiores que N (DFS)", [&]
+              { vector<pair<string, long>> arquivos; arvore.buscaArquivosMaiores(raiz_id, limiar, arquivos); return arquivos.size(); });
+        medir("maiores que N (paralelo)", [&]
+              { vector<pair<string, long>> arquivos; arvore.buscaArquivosMaiores(raiz_id, limiar, arquivos, num_threads); return arquivos.size(); });
+        medir("maiores que N (indice)", [&]
+              { return arvore.arquivosEntre(limiar + 1, INT64_MAX).size(); });
+        medir("100 maiores (indice)", [&]
+              { return arvore.maioresArquivos(100).size(); });
+        medir("pasta com mais arquivos", [&]
+              { int max_arquivos = -1; string caminho_pasta; arvore.encontraPastaComMaisArquivos(raiz_id, max_arquivos, caminho_pasta); return size_t(max_arquivos); });
+        medir("pasta com mais (paralelo)", [&]
+              { int max_arquivos = -1; string caminho_pasta; arvore.encontraPastaComMaisArquivos(raiz_id, max_arquivos, caminho_pasta, num_threads); return size_t(max_arquivos); });
+        medir("prefixo (monta indice)", [&]
+              { return arvore.idsPorPrefixo("arq_1").size(); });
+        medir("sufixo", [&]
+              { return arvore.idsPorSufixo("_7.log").size(); });
+        PadraoNome glob, expressao;
+        string erro;
+        glob.compilar("*_3?.log", false, erro);
+        expressao.compilar("_2[0-9]\\.txt$", true, erro);
+        medir("glob (bloco de nomes)", [&]
+              { return arvore.idsPorPadrao(glob).size(); });
+        medir("regex (bloco de nomes)", [&]
+              { return arvore.idsPorPadrao(expressao).size(); });
+
+        FILE *nulo = fopen("/dev/null", "wb");
+        if (nulo != nullptr)
+        {
+            vector<Consulta> lote;
+            for (const char *texto : {"maior", "vazias", "pasta-mais-arquivos", "extensao=.log"})
+            {
+                lote.emplace_back();
+                interpretarConsulta(texto, lote.back());
+            }
+            lote.emplace_back();
+            interpretarConsulta("maiores=" + to_string(limiar), lote.back());
+            medir("lote de consultas", [&]
+                  { EscritorBuffer saida(nulo); executarConsultas(arvore, lote, saida, num_threads); saida.descarregar(); return lote.size(); });
+            fclose(nulo);
+        }
+
+        FILE *descarte = fopen("/dev/null", "wb");
+        if (descarte != nullptr)
+        {
+            medir("exibicao em texto", [&]
+                  { EscritorBuffer saida(descarte); arvore.mostrar(raiz_id, saida); return arvore.tamanho(); });
+            OpcoesExibicao resumida;
+            resumida.profundidade_max = 3;
+            resumida.max_filhos = 10;
+            resumida.ordenar_por_tamanho = true;
+            medir("texto (prof. 3, 10 maiores)", [&]
+                  { EscritorBuffer saida(descarte); arvore.mostrar(raiz_id, saida, resumida); return arvore.tamanho(); });
+            fclose(descarte);
+        }
+
+        string html = temporaria + ".html";
+        for (bool recolhivel : {false, true})
+        {
+            medir(recolhivel ? "HTML recolhivel" : "HTML completo", [&]
+                  { exportarHTML(arvore, html, recolhivel); error_code e; return size_t(fs::file_size(html, e)); });
+        }
+        fs::remove(html);
+
+        string snap = temporaria + ".snap";
+        medir("salvar snapshot", [&]
+              { arvore.salvarSnapshot(snap); error_code e; return size_t(fs::file_size(snap, e)); });
+        medir("abrir snapshot", [&]
+              { ArvoreArquivos aberta; string erro; aberta.abrirSnapshot(snap, erro); return aberta.tamanho(); });
+        ArvoreArquivos anterior;
+        if (anterior.abrirSnapshot(snap, erro))
+        {
+            // Um arquivo alterado: a comparação desce só pelos ancestrais dele
+            uint32_t alterado = static_cast<uint32_t>(arvore.tamanho() - 1);
+            while (alterado > 0 && !arvore.ehArquivo(alterado))
+            {
+                alterado--;
+            }
+            arvore.alterarTamanho(alterado, arvore.no(alterado).tamanho + 1);
+            FILE *descarte = fopen("/dev/null", "wb");
+            if (descarte != nullptr)
+            {
+                medir("comparacao (1 alteracao)", [&]
+                      { EscritorBuffer saida(descarte); return compararArvores(anterior, arvore, saida).pastas_alteradas; });
+                fclose(descarte);
+            }
+        }
+        fs::remove(snap);
     }
+    return resultado;
+}
 
-    // Calcula o tamanho total de um nó e seus descendentes recursivamente
-    // @return O tamanho total em bytes:
-    //         - Para arquivos: retorna o tamanho do próprio arquivo
-    //         - Para pastas: soma o tamanho de todos os arquivos contidos nela e suas subpastas
-    // @note Este método é recursivo e percorre toda a árvore abaixo do nó atual
-    // @example Para uma pasta com estrutura:
-    //          /pasta (0 bytes)
-    //          ├── arquivo1.txt (100 bytes)
-    //          └── subpasta
-    //              └── arquivo2.txt (200 bytes)
-    //          O tamanho total será 300 bytes (100 + 200)
-    long calcularTamanhoTotal() const
+int main(int argc, char *argv[])
+{
+    fs::path diretorio_base = fs::current_path();
+    unsigned num_threads = 0; // 0 = um worker por núcleo
+    string arquivo_snapshot;  // snapshot a abrir no lugar da varredura
+    string salvar_snapshot;   // snapshot a gravar logo após a carga
+    bool monitorar = false;   // mantém a árvore atualizada com os eventos do sistema de arquivos
+    vector<Consulta> consultas; // modo não interativo: consultas a executar no lugar do menu
+    vector<string> textos_consultas; // consultas como digitadas em -c (interpretadas após os argumentos)
+    bool bench = false;         // mede o desempenho em árvores sintéticas no lugar do menu
+    ConfigBench config_bench;
+    string arquivo_stats;       // relatório JSON de tempos e contadores gravado ao sair
+    bool sem_progresso = false; // não exibe a linha de progresso da varredura
+    bool uso_disco = false;     // blocos alocados no lugar do tamanho aparente, hardlinks contados uma vez
+    bool tamanhos_depois = false; // carrega só a estrutura e lê os tamanhos em segundo plano
+    bool atualizar = false;       // relista só as pastas do snapshot que mudaram no disco
+    string comparar_com;          // snapshot ou pasta de referência para --diff
+    string socket_servir;         // socket Unix em que as consultas são servidas (--servir)
+    string socket_conectar;       // socket de um servidor a consultar no lugar de carregar a árvore
+    for (int i = 1; i < argc; i++)
     {
-        if (tipo == "arquivo")
+        string arg = argv[i];
+        if ((arg == "-c" || arg == "--consulta") && i + 1 < argc)
+        {
+            textos_consultas.push_back(argv[++i]);
+            continue;
+        }
+        if (arg == "--bench" && i + 1 < argc)
+        {
+            bench = true;
+            if (!interpretarBench(argv[++i], config_bench))
+            {
+                cerr << "Especificacao de benchmark invalida: \"" << argv[i] << "\"" << endl;
+                return 2;
+            }
+            continue;
+        }
+        if ((arg == "-j" || arg == "--threads") && i + 1 < argc)
+        {
+            string_view texto = argv[++i];
+            auto [resto, ec] = from_chars(texto.data(), texto.data() + texto.size(), num_threads);
+            if (ec != errc() || resto != texto.data() + texto.size())
+            {
+                cerr << "Numero de threads invalido: \"" << texto << "\" (use -j N, com N >= 0; 0 = um por nucleo)" << endl;
+                return 2;
+            }
+        }
+        else if (arg == "--snapshot" && i + 1 < argc)
+        {
+            arquivo_snapshot = argv[++i];
+        }
+        else if (arg == "--salvar" && i + 1 < argc)
+        {
+            salvar_snapshot = argv[++i];
+        }
+        else if (arg == "--monitorar")
+        {
+            monitorar = true;
+        }
+        else if (arg == "--stats" && i + 1 < argc)
         {
-            return tamanho;
+            arquivo_stats = argv[++i];
         }
-
-        long tamanho_total = 0;
-        for (const auto &filho : filhos)
+        else if (arg == "--sem-progresso")
         {
-            tamanho_total += filho.calcularTamanhoTotal();
+            sem_progresso = true;
         }
-        return tamanho_total;
-    }
-
-    // Exibe a estrutura de arquivos e diretórios em formato de árvore no console
-    // @param nivel: Nível de profundidade do nó atual na árvore (0 para raiz)
-    // @param ultimo: Indica se é o último item em seu nível (true = ├──, false = └──)
-    // @note Este método usa caracteres especiais para criar a visualização hierárquica:
-    //       │   : Linha vertical para conectar níveis
-    //       ├── : Conexão para itens intermediários
-    //       └── : Conexão para o último item
-    // @example Exemplo de saída:
-    //          pasta (2 filhos, 300 bytes)
-    //          ├── arquivo.txt (100 bytes)
-    //          └── subpasta (1 filho, 200 bytes)
-    //              └── outro.txt (200 bytes)
-    void mostrar(int nivel = 0, bool ultimo = true) const
-    {
-        // Indentação inicial
-        if (nivel > 0)
+        else if (arg == "--uso-disco")
         {
-            for (int i = 0; i < nivel - 1; i++)
-            {
-                cout << "|   ";
-            }
-            cout << (ultimo ? "└── " : "├── ");
+            uso_disco = true;
         }
-
-        // Nome e informações
-        cout << nome;
-        if (tipo == "arquivo")
+        else if (arg == "--tamanhos-depois")
         {
-            cout << " (" << tamanho << " bytes)";
+            tamanhos_depois = true;
         }
-        else
+        else if (arg == "--atualizar")
         {
-            int num_filhos = contarFilhos();
-            long tamanho_total = calcularTamanhoTotal();
-            cout << " (" << num_filhos << (num_filhos == 1 ? " filho" : " filhos")
-                 << ", " << tamanho_total << " bytes)";
+            atualizar = true;
         }
-        cout << endl;
-
-        // Mostra filhos com a linha vertical
-        if (!filhos.empty())
+        else if (arg == "--diff" && i + 1 < argc)
         {
-            for (size_t i = 0; i < filhos.size(); i++)
-            {
-                filhos[i].mostrar(nivel + 1, i == filhos.size() - 1);
-            }
+            comparar_com = argv[++i];
         }
-    }
-
-    // Gera a representação HTML da árvore de arquivos e diretórios
-    // @param nivel: Nível de profundidade do nó atual na árvore (0 para raiz)
-    // @param ultimo: Indica se é o último item em seu nível (true para último item)
-    // @return Uma string contendo o HTML formatado com indentação e estilos
-    // @note Este método gera uma representação visual da árvore usando caracteres especiais:
-    //       │   : Linha vertical para conectar níveis
-    //       ├── : Conexão para itens intermediários
-    //       └── : Conexão para o último item
-    // @example Exemplo de saída HTML:
-    //          <span class='pasta'>documentos (2 filhos, 300 bytes)</span>
-    //          ├── <span class='arquivo'>relatorio.txt (100 bytes)</span>
-    //          └── <span class='pasta'>imagens (1 filho, 200 bytes)</span>
-    string gerarHTML(int nivel = 0, bool ultimo = true) const
-    {
-
-        string html;
-
-        // Indentação inicial
-        for (int i = 0; i < nivel; i++)
+        else if (arg == "--servir" && i + 1 < argc)
         {
-            html += (i == nivel - 1 ? (ultimo ? "└── " : "├── ") : "│   ");
+            socket_servir = argv[++i];
         }
-
-        // Nome e informações
-        html += "<span class='" + tipo + "'>" + nome;
-        if (tipo == "arquivo")
+        else if (arg == "--conectar" && i + 1 < argc)
         {
-            html += " (" + to_string(tamanho) + " bytes)";
+            socket_conectar = argv[++i];
         }
         else
         {
-            int num_filhos = contarFilhos();
-            long tamanho_total = calcularTamanhoTotal();
-            html += " (" + to_string(num_filhos) + (num_filhos == 1 ? " filho" : " filhos") + ", " + to_string(tamanho_total) + " bytes)";
+            diretorio_base = arg;
         }
-        html += "</span><br>\n";
+    }
 
-        // Adiciona filhos
-        if (!filhos.empty())
+    if (!socket_conectar.empty())
+    {
+        // Cliente: as requisições vão para o servidor, que já tem a árvore carregada
+        if (textos_consultas.empty())
         {
-            for (size_t i = 0; i < filhos.size(); i++)
-            {
-                html += filhos[i].gerarHTML(nivel + 1, i == filhos.size() - 1);
-            }
+            cerr << "--conectar precisa de ao menos uma consulta (-c)" << endl;
+            return 2;
         }
-
-        return html;
+        return consultarServidor(socket_conectar, textos_consultas);
     }
-    // função recursiva que encontra o(s) arquivo(s) de maior tamanho na árvore de arquivos
-    // max_tam: referência para o maior tamanho encontrado até o momento
-    // caminhos: referência para um vetor que acumula os caminhos dos arquivos de maior tamanho
-    // a função atualiza max_tam e caminhos conforme percorre a árvore
-    void encontraMaiorArquivo(long &max_tam, vector<string> &caminhos) const
+    for (const string &texto : textos_consultas)
     {
-        if (tipo == "arquivo")
-        { // se o nó for arquivo
-            if (tamanho > max_tam)
-            {                                         // e se for maior que o tamanho atual máximo
-                max_tam = tamanho;                    // atualiza o maior tamanho
-                caminhos.clear();                     // limpa os caminhos anteriores
-                caminhos.push_back(caminho_completo); // adiciona o novo maior
-            }
-            else if (tamanho == max_tam)
-            {
-                caminhos.push_back(caminho_completo); // se for do mesmo tamanho do maior, adiciona também
-            }
-        }
-        for (const auto &filho : filhos)
-        { // aplica recursivamente para todos os filhos (arquivos e subpastas)
-            filho.encontraMaiorArquivo(max_tam, caminhos);
+        Consulta consulta;
+        if (!interpretarConsulta(texto, consulta))
+        {
+            cerr << "Consulta invalida: \"" << texto << "\"" << endl;
+            return 2;
         }
+        consultas.push_back(consulta);
     }
-    // função recursiva que busca todos os arquivos com uma extensão específica dentro da árvore.
-    // ext: extensão procurada (ex: ".txt", ".cpp").
-    // arquivos: vetor que armazena os caminhos completos dos arquivos encontrados
-    // visitados: conjunto de caminhos já visitados (para evitar loops com links simbólicos ou duplicações)
-    // utiliza std::filesystem para extrair a extensão de forma robusta
-    //       Evita a repetição de diretórios já visitados usando uma hash set.
-    //       Busca em profundidade (DFS) por toda a árvore.
-    void buscaPorExtensao(const string &ext, vector<string> &arquivos, std::unordered_set<string> &visitados) const
+    if (!socket_servir.empty() && (!consultas.empty() || !comparar_com.empty()))
+    {
+        cerr << "--servir nao combina com -c nem com --diff" << endl;
+        return 2;
+    }
+
+    // Grava o relatório --stats (se pedido) com a memória da árvore no momento da saída
+    auto gravarRelatorio = [&](const ArvoreArquivos *arvore)
     {
-        if (visitados.count(caminho_completo)) return; // Prevenir loops infinitos, ele verifica se o caminho já foi visitado
-        visitados.insert(caminho_completo);
-        // não funciona para arquivos com ponto no nome, pois busca pela extensão literalmente
-        if (tipo == "arquivo" && fs::path(nome).extension() == ext)
+        if (arquivo_stats.empty())
         {
-            arquivos.push_back(caminho_completo); // adiciona à lista de resultados
+            return;
         }
-
-        for (const auto &filho : filhos)
-        { // aplica recursivamente a busca para todos os filhos
-            filho.buscaPorExtensao(ext, arquivos, visitados);
+        size_t bytes = (arvore && !arvore->mapeada()) ? arvore->bytesUsados() : 0;
+        if (!instrumentacao.gravarJSON(arquivo_stats, bytes, arvore ? arvore->tamanho() : 0,
+                                       arvore ? arvore->vinculosPromovidos() : 0))
+        {
+            cerr << "Erro ao gravar estatisticas \"" << arquivo_stats << "\"" << endl;
         }
+    };
+
+    if (bench)
+    {
+        int codigo = executarBench(config_bench, num_threads);
+        gravarRelatorio(nullptr);
+        return codigo;
     }
 
-    // função recursiva que encontra todas as pastas vazias na árvore de arquivos
-    // vazias: vetor que armazena os caminhos completos das pastas sem nenhum filho
-    // uma pasta é considerada vazia se não possui nem arquivos nem subpastas diretamente dentro dela
-    void encontraPastasVazias(vector<string> &vazias) const
+    // No modo não interativo a saída padrão fica só com os resultados; o resto vai para stderr
+    ostream &status = (consultas.empty() && comparar_com.empty()) ? cout : cerr;
+
+    instrumentacao.progresso = !sem_progresso && isatty(STDERR_FILENO);
+    auto inicio_carga = chrono::steady_clock::now();
+    ArvoreArquivos arvore;
+    // Com o monitoramento ativo ou os tamanhos sendo preenchidos, a árvore é alterada
+    // por outro thread: as consultas do menu usam a trava de leitura e as alterações, a de escrita
+    shared_mutex trava_arvore;
+    if (!arquivo_snapshot.empty())
     {
-        if (tipo == "pasta")
-        { // se for pasta
-            if (filhos.empty())
-            {
-                vazias.push_back(caminho_completo); // se não tiver filhos, é vazia
-            }
-            else
-            {
-                for (const auto &filho : filhos)
-                { // senão, verifica recursivamente os filhos
-                    filho.encontraPastasVazias(vazias);
-                }
-            }
+        // Abre a árvore salva anteriormente, sem varrer o disco
+        string erro;
+        if (!arvore.abrirSnapshot(arquivo_snapshot, erro))
+        {
+            cerr << "Erro ao abrir snapshot \"" << arquivo_snapshot << "\": " << erro << endl;
+            return 1;
+        }
+        instrumentacao.registrarFase("abrir snapshot", inicio_carga, arvore.tamanho());
+        status << "Snapshot: " << arquivo_snapshot << "\n";
+        status << "Diretorio inicial: " << arvore.caminhoRaiz() << "\n\n";
+        if (atualizar)
+        {
+            // Compara cada pasta com o disco e relista só as que mudaram desde o snapshot
+            auto inicio_atualizacao = chrono::steady_clock::now();
+            size_t verificadas = arvore.estatisticas(arvore.raiz()).num_pastas + 1;
+            vector<uint32_t> pastas_novas;
+            size_t relistadas = revalidarPastas(arvore, arvore.raiz(), num_threads, pastas_novas);
+            recarregarPastas(arvore, trava_arvore, pastas_novas, num_threads, nullptr);
+            instrumentacao.registrarFase("atualizacao incremental", inicio_atualizacao, verificadas);
+            auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - inicio_atualizacao).count();
+            status << "Atualizado em " << ms << " ms: " << verificadas << " pasta(s) verificada(s), " << relistadas
+                   << " relistada(s), " << pastas_novas.size() << " nova(s)\n";
         }
     }
-    // Função recursiva que encontra todos os arquivos cujo tamanho é maior que N bytes.
-    // Os arquivos encontrados são adicionados ao vetor 'arquivos' como pares <caminho, tamanho>.
-    void buscaArquivosMaiores(long n, vector<pair<string, long>> &arquivos) const
+    else if (atualizar)
     {
-        // Verifica se o nó é um arquivo e se seu tamanho é maior que n
-        if (tipo == "arquivo" && tamanho > n)
+        cerr << "--atualizar precisa de --snapshot" << endl;
+        return 2;
+    }
+    else
+    {
+        status << "Diretorio inicial: " << diretorio_base << "\n\n";
+
+        // Carrega a árvore REAL do sistema de arquivos
+        arvore = carregarArvore(diretorio_base, num_threads, uso_disco, tamanhos_depois);
+    }
+    auto duracao_carga = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - inicio_carga);
+    instrumentacao.progresso = false; // só a carga inicial e as recargas pedidas no menu exibem progresso
+
+    const EstatisticasNo &totais = arvore.estatisticas(arvore.raiz());
+    status << "Arvore carregada em " << duracao_carga.count() << " ms: " << totais.num_arquivos << " arquivos, "
+         << totais.num_pastas << " pastas, " << totais.tamanho_total << " bytes, profundidade "
+         << totais.profundidade_max << (arvore.usoDisco() ? " (uso em disco)" : "") << "\n";
+    tamanhos_depois = tamanhos_depois && arquivo_snapshot.empty();
+    if (tamanhos_depois)
+    {
+        status << "Tamanhos dos arquivos sendo lidos em segundo plano (os totais crescem conforme chegam)\n";
+    }
+    if (arvore.mapeada())
+    {
+        status << "Memoria da arvore: mapeada do snapshot (paginas lidas sob demanda)\n";
+    }
+    else
+    {
+        status << "Memoria da arvore: " << arvore.bytesUsados() << " bytes ("
+             << arvore.bytesUsados() / arvore.tamanho() << " bytes por item)\n";
+    }
+
+    PreenchedorTamanhos preenchedor(arvore, trava_arvore);
+    if (tamanhos_depois)
+    {
+        preenchedor.iniciar(0);
+        if (!salvar_snapshot.empty() || !consultas.empty() || !comparar_com.empty())
         {
-            // Se a condição for satisfeita, adiciona o caminho completo e o tamanho ao vetor de resultados.
-            arquivos.push_back({caminho_completo, tamanho});
+            // O snapshot, as consultas não interativas e a comparação precisam dos tamanhos completos
+            auto inicio_espera = chrono::steady_clock::now();
+            preenchedor.aguardar();
+            status << "Tamanhos preenchidos em "
+                   << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - inicio_espera).count()
+                   << " ms (" << preenchedor.metodo() << "): " << arvore.estatisticas(arvore.raiz()).tamanho_total << " bytes\n";
         }
+    }
 
-        // Itera por todos os filhos do nó atual (caso seja uma pasta) e aplica a função recursivamente.
-        for (const auto &filho : filhos)
+    if (!salvar_snapshot.empty())
+    {
+        auto inicio_salvar = chrono::steady_clock::now();
+        bool salvou = arvore.salvarSnapshot(salvar_snapshot);
+        instrumentacao.registrarFase("salvar snapshot", inicio_salvar, arvore.tamanho());
+        if (salvou)
         {
-            filho.buscaArquivosMaiores(n, arquivos);
+            status << "Snapshot salvo: " << salvar_snapshot << "\n";
+        }
+        else
+        {
+            cerr << "Erro ao salvar snapshot \"" << salvar_snapshot << "\"" << endl;
         }
     }
-    // Função recursiva que encontra a pasta com o maior número de arquivos diretamente dentro dela (não recursivo).
-    void encontraPastaComMaisArquivos(int &max_arquivos, string &caminho_pasta) const
+
+    if (!comparar_com.empty())
     {
-        // Verifica se o nó atual é uma pasta.
-        if (tipo == "pasta")
+        // Diferenças em relação à referência (a árvore carregada é a nova)
+        ArvoreArquivos referencia;
+        string erro;
+        if (!carregarReferencia(comparar_com, num_threads, arvore.usoDisco(), referencia, erro))
         {
-            int arquivos_diretos = 0; // Contador para arquivos diretamente nesta pasta.
-            // Itera sobre os filhos imediatos do nó atual.
-            for (const auto &filho : filhos)
-            {
-                // Se o filho for um arquivo, incrementa o contador.
-                if (filho.tipo == "arquivo")
-                {
-                    arquivos_diretos++;
-                }
-            }
-            // Se a quantidade de arquivos diretos nesta pasta for maior do que a máxima encontrada até agora, atualiza os valores de referência.
-            if (arquivos_diretos > max_arquivos)
-            {
-                max_arquivos = arquivos_diretos;
-                caminho_pasta = caminho_completo;
-            }
-            // Chama recursivamente a função para os filhos (subpastas) do nó atual.
-            for (const auto &filho : filhos)
-            {
-                filho.encontraPastaComMaisArquivos(max_arquivos, caminho_pasta);
-            }
+            cerr << "Erro ao abrir \"" << comparar_com << "\": " << (erro.empty() ? "nao e pasta nem snapshot" : erro) << endl;
+            return 1;
+        }
+        if (referencia.usoDisco() != arvore.usoDisco())
+        {
+            cerr << "Aviso: uma arvore usa tamanhos aparentes e a outra, uso em disco" << endl;
+        }
+        EscritorBuffer saida(stdout);
+        ResumoDiferencas resumo = compararArvores(referencia, arvore, saida);
+        saida.descarregar();
+        status << resumo.adicionados << " adicionado(s), " << resumo.removidos << " removido(s), " << resumo.alterados
+               << " alterado(s), " << resumo.pastas_alteradas << " pasta(s) percorrida(s), delta " << resumo.delta << " bytes\n";
+        if (consultas.empty())
+        {
+            gravarRelatorio(&arvore);
+            return saida.falhou() ? 1 : 0;
         }
     }
-};
 
-// Função que exporta a árvore de arquivos para um arquivo HTML
-// @param raiz: Nó raiz da árvore de arquivos a ser exportada
-// @param caminho: Caminho do arquivo HTML de saída
-// @note Esta função cria um documento HTML completo com:
-//       - Codificação UTF-8 para suporte a caracteres especiais
-//       - Estilos CSS para formatação visual (cores e fontes)
-//       - Estrutura hierárquica mantida através de indentação
-// @example O arquivo HTML gerado terá:
-//          - Arquivos em preto
-//          - Diretórios em verde
-//          - Fonte monoespaçada para alinhamento
-void exportarHTML(const FileNode &raiz, const string &arquivo_saida)
-{
-    ofstream arquivo(arquivo_saida);
-    if (!arquivo.is_open())
+    if (!consultas.empty())
     {
-        cout << "Erro ao criar arquivo HTML!" << endl;
-        return;
+        EscritorBuffer saida(stdout);
+        bool ok = executarConsultas(arvore, consultas, saida, num_threads);
+        saida.descarregar();
+        gravarRelatorio(&arvore);
+        return ok && !saida.falhou() ? 0 : 1;
     }
 
-    arquivo << "<!DOCTYPE html>\n"
-            << "<html>\n<head>\n"
-            << "    <meta charset='UTF-8'>\n"
-            << "    <title>Árvore de Arquivos</title>\n"
-            << "    <style>\n"
-            << "        body { \n"
-            << "            font-family: monospace;\n"
-            << "            white-space: pre;\n"
-            << "            margin: 20px;\n"
-            << "        }\n"
-            << "        .arquivo { color: black; }\n"
-            << "        .pasta { color: green; }\n"
-            << "    </style>\n"
-            << "</head>\n<body>\n"
-            << raiz.gerarHTML(0, true)
-            << "</body>\n</html>";
-
-    arquivo.close();
-    cout << "Arquivo HTML gerado com sucesso: " << arquivo_saida << endl;
-}
-
-// Função que carrega a árvore de diretórios REAL
-FileNode carregarArvore(const fs::path &caminho, std::unordered_set<std::string> &visitados)
-{
-    // Evita visitar o mesmo caminho duas vezes (ex: links simbólicos)
-    std::string caminhoStr = fs::canonical(caminho).string();
-    if (visitados.count(caminhoStr)) return FileNode(caminho.filename().string(), "pasta", 0, caminhoStr);
-    visitados.insert(caminhoStr);
-
-    FileNode raiz(caminho.filename().string(), "pasta", 0, caminhoStr);
-
-    try
+    MonitorArvore monitor(arvore, trava_arvore);
+    if (monitorar)
     {
-        for (const auto &entry : fs::directory_iterator(caminho, fs::directory_options::skip_permission_denied))
+        string erro;
+        if (monitor.iniciar(erro))
         {
-            try
-            {
-                if (!entry.is_symlink() && !entry.is_block_file() && !entry.is_character_file())
-                {
-                    if (entry.is_directory())
-                    {
-                        FileNode subpasta = carregarArvore(entry.path(), visitados);
-                        raiz.adicionarFilho(subpasta);
-                    }
-                    else if (entry.is_regular_file())
-                    {
-                        raiz.adicionarFilho(FileNode(
-                            entry.path().filename().string(),
-                            "arquivo",
-                            entry.file_size(),
-                            entry.path().string()));
-                    }
-                }
-            }
-            catch (const fs::filesystem_error &e)
-            {
-                std::cerr << "Aviso interno: não foi possível acessar \"" << entry.path()
-                          << "\": " << e.what() << std::endl;
-            }
+            shared_lock<shared_mutex> leitura(trava_arvore);
+            cout << "Monitorando alteracoes em " << monitor.pastasObservadas() << " pastas\n";
+        }
+        else
+        {
+            cerr << "Aviso: monitoramento indisponivel: " << erro << endl;
         }
     }
-    catch (const fs::filesystem_error &e)
+
+    if (!socket_servir.empty())
     {
-        std::cerr << "Aviso: não foi possível acessar \"" << caminho << "\": " << e.what() << std::endl;
+        // Servidor residente: a árvore fica carregada (e atualizada, com --monitorar) e as
+        // consultas chegam pelo socket no lugar do menu
+        ServidorConsultas servidor(arvore, trava_arvore, num_threads, monitor.ativo() ? &monitor : nullptr);
+        string erro;
+        if (!servidor.iniciar(socket_servir, erro))
+        {
+            cerr << "Erro ao criar o socket \"" << socket_servir << "\": " << erro << endl;
+            preenchedor.parar();
+            monitor.parar();
+            return 1;
+        }
+        cout << "Servindo consultas em " << socket_servir << " (requisicao \"encerrar\" ou Ctrl+C para sair)" << endl;
+        servidor.executar();
+        preenchedor.parar();
+        monitor.parar();
+        cout << "Servidor encerrado: " << servidor.requisicoesAtendidas() << " requisicao(oes) atendida(s)" << endl;
+        gravarRelatorio(&arvore);
+        return 0;
     }
 
-    return raiz;
-}
-
-int main(int argc, char *argv[])
-{
-    std::unordered_set<std::string> visitados;
-    fs::path diretorio_base = (argc > 1) ? argv[1] : fs::current_path();
-    cout << "Diretorio inicial: " << diretorio_base << "\n\n";
-
-    // Carrega a árvore REAL do sistema de arquivos
-    FileNode raiz = carregarArvore(diretorio_base, visitados);
-
     // Menu principal
     int opcao_usuario;
     do
     {
         cout << "\nOpcoes:\n";
+        if (monitor.ativo())
+        {
+            cout << "(monitorando: " << monitor.eventosAplicados() << " eventos aplicados)\n";
+        }
+        if (preenchedor.ativo())
+        {
+            cout << "(tamanhos: " << preenchedor.preenchidos() << " de " << preenchedor.total() << " lidos via "
+                 << preenchedor.metodo() << ")\n";
+        }
         cout << "1. Exibir arvore\n";
         cout << "2. Exportar HTML\n";
         cout << "3. Pesquisar\n";
         cout << "4. Sair\n";
+        cout << "5. Recarregar pasta\n";
+        cout << "6. Salvar snapshot\n";
+        cout << "7. Comparar com snapshot ou pasta\n";
         cout << "Digite: ";
         cin >> opcao_usuario;
 
         switch (opcao_usuario)
         {
         case 1:
-            cout << "\nEstrutura:\n";
-            raiz.mostrar();
+        {
+            OpcoesExibicao opcoes;
+            int ordenar;
+            cout << "Profundidade maxima (-1 = todas): ";
+            cin >> opcoes.profundidade_max;
+            cout << "Filhos por pasta, os maiores (0 = todos): ";
+            cin >> opcoes.max_filhos;
+            cout << "Ordenar por tamanho (1 = sim, 0 = nao): ";
+            cin >> ordenar;
+            opcoes.ordenar_por_tamanho = (ordenar == 1);
+            shared_lock<shared_mutex> leitura(trava_arvore);
+            cout << "\nEstrutura:\n" << flush;
+            auto inicio_exibir = chrono::steady_clock::now();
+            {
+                EscritorBuffer saida(stdout);
+                arvore.mostrar(arvore.raiz(), saida, opcoes);
+            }
+            fflush(stdout);
+            instrumentacao.registrarConsulta("exibir", inicio_exibir, arvore.tamanho());
             break;
+        }
 
         case 2:
         {
             string arquivo_saida = "arvore.html";
+            int formato;
+            cout << "Formato (1 = arvore completa, 2 = secoes recolhiveis): ";
+            cin >> formato;
             cout << "\nExportando para HTML...\n";
-            exportarHTML(raiz, arquivo_saida);
+            shared_lock<shared_mutex> leitura(trava_arvore);
+            auto inicio_html = chrono::steady_clock::now();
+            bool gerado = exportarHTML(arvore, arquivo_saida, formato == 2);
+            double ms = instrumentacao.registrarConsulta(formato == 2 ? "html-recolhivel" : "html", inicio_html, arvore.tamanho());
+            if (gerado)
+            {
+                cout << "Arquivo HTML gerado com sucesso: " << arquivo_saida << " (" << ms << " ms)" << endl;
+            }
+            else
+            {
+                cout << "Erro ao gerar arquivo HTML!" << endl;
+            }
             break;
         }
 
@@ -421,14 +6725,39 @@ int main(int argc, char *argv[])
             cout << "3. Pastas vazias\n";
             cout << "4. Arquivos maiores que N bytes\n";
             cout << "5. Pasta com mais arquivos diretos\n";
+            cout << "6. Arquivos por inicio ou fim do nome\n";
+            cout << "7. K maiores arquivos\n";
+            cout << "8. Arquivos entre A e B bytes\n";
+            cout << "9. Arquivos por padrao de nome (glob ou regex)\n";
+            cout << "10. Arquivos duplicados\n";
             cout << "Digite: ";
             cin >> sub_opcao;
+            shared_lock<shared_mutex> leitura(trava_arvore, defer_lock); // tomada após as perguntas ao usuário
+            chrono::steady_clock::time_point inicio_consulta;
+            size_t resultados = 0;
+            bool consultou = false; // a consulta chegou a ser executada (e é medida)
+            auto travar = [&]
+            {
+                leitura.lock();
+                inicio_consulta = chrono::steady_clock::now(); // o tempo medido começa com a trava
+                consultou = true;
+            };
 
             if (sub_opcao == 1)
             {
                 long max_tam = -1;                            // inicializa max_tam com -1 para representar um tamanho inicial inválido
                 vector<string> caminhos;                      // vetor caminhos para armazenar o caminho do maior arquivo
-                raiz.encontraMaiorArquivo(max_tam, caminhos); // chama a função recursiva a partir da raiz da árvore
+                travar();
+                auto maior = arvore.maioresArquivos(1);       // o índice de tamanhos dá o maior tamanho direto
+                if (!maior.empty())
+                {
+                    max_tam = maior[0].second;
+                    for (const auto &[id, tam] : arvore.arquivosEntre(max_tam, max_tam)) // todos os empatados
+                    {
+                        caminhos.push_back(arvore.caminho(id));
+                    }
+                }
+                resultados = caminhos.size();
                 if (caminhos.empty())
                 {
                     cout << "\nSem arquivos para esta seleção\n";
@@ -444,12 +6773,13 @@ int main(int argc, char *argv[])
             }
             else if (sub_opcao == 2)    
             {
-                std::unordered_set<std::string> visitados;       // unordered_set para registrar os caminhos já visitados para evitar loops infinitos
                 string ext;
                 cout << "Extensao: ";                            // solicita ao usuário a extensão a ser buscada
                 cin >> ext;
                 vector<string> arquivos;                         // chama a função recursiva para buscar arquivos com a extensão especificada, armazenando os caminhos no vetor arquivos
-                raiz.buscaPorExtensao(ext, arquivos, visitados); 
+                travar();
+                arvore.buscaPorExtensao(ext, arquivos);
+                resultados = arquivos.size();
                 
                 if (arquivos.empty())
                 {
@@ -467,7 +6797,9 @@ int main(int argc, char *argv[])
             else if (sub_opcao == 3)
             {
                 vector<string> vazias;                // vetor "vazias" para armazenar os caminhos das pastas que não possuem nenhum filho (nem arquivos, nem subpastas).
-                raiz.encontraPastasVazias(vazias);    // chama a função de forma recursiva 
+                travar();
+                arvore.encontraPastasVazias(arvore.raiz(), vazias, num_threads);  // percorre as subárvores em paralelo
+                resultados = vazias.size();
                 cout << "\nPastas vazias:\n";         // imprime a lista de pastas vazias encontradas
                 for (const auto &pasta : vazias)
                 {
@@ -479,19 +6811,22 @@ int main(int argc, char *argv[])
                 long n;                                                 // solicita ao usuário o valor N em bytes para comparar com os tamanhos dos arquivos
                 cout << "Digite o valor N (em bytes): ";                
                 cin >> n;
-                vector<pair<string, long>> arquivos;                    //  executa a busca recursiva, armazenando os arquivos maiores que N como pares <caminho, tamanho>.
-                raiz.buscaArquivosMaiores(n, arquivos);
+                travar();                                         //  consulta o índice de tamanhos: resultados do maior para o menor
+                auto arquivos = (n == LONG_MAX) ? vector<pair<uint32_t, int64_t>>() : arvore.arquivosEntre(n + 1, INT64_MAX);
+                resultados = arquivos.size();
                 cout << "\nArquivos maiores que " << n << " bytes:\n"; 
-                for (const auto &[caminho, tam] : arquivos)
+                for (const auto &[id, tam] : arquivos)
                 {
-                    cout << caminho << " (" << tam << " bytes)\n";      // lista os arquivos encontrados e seus respectivos tamanhos
+                    cout << arvore.caminho(id) << " (" << tam << " bytes)\n"; // lista os arquivos encontrados e seus respectivos tamanhos
                 }
             }
             else if (sub_opcao == 5)
             {
                 int max_arquivos = -1;                                                  // inicia a variável max_arquivos com -1 e caminho_pasta vazio
                 string caminho_pasta;
-                raiz.encontraPastaComMaisArquivos(max_arquivos, caminho_pasta);         // chama função recursiva que atualiza "max_arquivos" com a maior quantidade de arquivos diretos e armazena o caminho da pasta correspondente
+                travar();
+                arvore.encontraPastaComMaisArquivos(arvore.raiz(), max_arquivos, caminho_pasta, num_threads); // percorre as subárvores em paralelo que atualiza "max_arquivos" com a maior quantidade de arquivos diretos e armazena o caminho da pasta correspondente
+                resultados = (max_arquivos >= 0) ? 1 : 0;
                 if (max_arquivos >= 0)                                                  // se encontrou alguma pasta com arquivos diretos, exibe a pasta e o número de arquivos
                 {
                     cout << "\nPasta com mais arquivos diretos:\n";
@@ -502,10 +6837,136 @@ int main(int argc, char *argv[])
                     cout << "\nNenhuma pasta encontrada.\n";                             // se não encontrou nenhuma pasta com arquivos, exibe mensagem alternativa.
                 }
             }
+            else if (sub_opcao == 6)
+            {
+                string padrao;
+                cout << "Prefixo (ex: relatorio*) ou sufixo (ex: *.tar.gz): ";
+                cin >> padrao;
+                bool sufixo = !padrao.empty() && padrao.front() == '*';
+                string_view texto = padrao;
+                if (sufixo)
+                {
+                    texto.remove_prefix(1);
+                }
+                else if (!texto.empty() && texto.back() == '*')
+                {
+                    texto.remove_suffix(1);
+                }
+                travar();
+                vector<uint32_t> ids = sufixo ? arvore.idsPorSufixo(texto) : arvore.idsPorPrefixo(texto);
+                resultados = ids.size();
+                if (ids.empty())
+                {
+                    cout << "\nSem arquivos para esta seleção\n";
+                }
+                else
+                {
+                    cout << "\nArquivos com nome " << (sufixo ? "terminado" : "iniciado") << " em \"" << texto << "\":\n";
+                    for (uint32_t id : ids)
+                    {
+                        cout << arvore.caminho(id) << "\n";
+                    }
+                }
+            }
+            else if (sub_opcao == 7 || sub_opcao == 8)
+            {
+                vector<pair<uint32_t, int64_t>> arquivos;
+                if (sub_opcao == 7)
+                {
+                    size_t k;
+                    cout << "Quantidade K: ";
+                    cin >> k;
+                    travar();
+                    arquivos = arvore.maioresArquivos(k);
+                    cout << "\n" << arquivos.size() << " maior(es) arquivo(s):\n";
+                }
+                else
+                {
+                    int64_t minimo, maximo;
+                    cout << "Tamanho minimo A (em bytes): ";
+                    cin >> minimo;
+                    cout << "Tamanho maximo B (em bytes): ";
+                    cin >> maximo;
+                    travar();
+                    arquivos = arvore.arquivosEntre(minimo, maximo);
+                    cout << "\nArquivos entre " << minimo << " e " << maximo << " bytes:\n";
+                }
+                resultados = arquivos.size();
+                for (const auto &[id, tam] : arquivos)
+                {
+                    cout << arvore.caminho(id) << " (" << tam << " bytes)\n";
+                }
+            }
+            else if (sub_opcao == 9)
+            {
+                int tipo;
+                string texto, erro;
+                cout << "Tipo (1 = glob, ex: *core*.dmp; 2 = regex): ";
+                cin >> tipo;
+                cout << "Padrao: ";
+                cin >> ws;
+                getline(cin, texto);
+                PadraoNome padrao;
+                if (!padrao.compilar(texto, tipo == 2, erro))
+                {
+                    cout << "Expressao invalida: " << erro << "\n";
+                }
+                else
+                {
+                    travar();
+                    vector<uint32_t> ids = arvore.idsPorPadrao(padrao);
+                    resultados = ids.size();
+                    if (ids.empty())
+                    {
+                        cout << "\nSem arquivos para esta seleção\n";
+                    }
+                    else
+                    {
+                        cout << "\nArquivos com nome casando com \"" << texto << "\":\n";
+                        for (uint32_t id : ids)
+                        {
+                            cout << arvore.caminho(id) << "\n";
+                        }
+                    }
+                }
+            }
+            else if (sub_opcao == 10)
+            {
+                int64_t minimo;
+                cout << "Tamanho minimo (em bytes): ";
+                cin >> minimo;
+                preenchedor.aguardar(); // os grupos por tamanho precisam dos tamanhos completos
+                travar();
+                vector<CandidatoDuplicado> candidatos = candidatosDuplicados(arvore, minimo);
+                leitura.unlock(); // o conteúdo é lido sem bloquear o monitoramento
+                ResultadoDuplicados duplicados = encontrarDuplicados(candidatos, arvore.usoDisco(), num_threads);
+                resultados = duplicados.conjuntos.size();
+                for (const ConjuntoDuplicados &conjunto : duplicados.conjuntos)
+                {
+                    cout << "\n" << conjunto.ids.size() << " copias de " << conjunto.tamanho << " bytes ("
+                         << conjunto.recuperavel() << " bytes recuperaveis):\n";
+                    for (const string &caminho : conjunto.caminhos)
+                    {
+                        cout << "  " << caminho << "\n";
+                    }
+                }
+                cout << "\n" << duplicados.conjuntos.size() << " conjunto(s), " << duplicados.recuperavel
+                     << " bytes recuperaveis (" << duplicados.candidatos << " candidato(s) abertos, "
+                     << duplicados.leituras_completas << " lido(s) por inteiro, " << duplicados.bytes_lidos << " bytes lidos)\n";
+            }
             else
             {
                 cout << "Opcao invalida.\n";     // mensagem caso a sub_opcao seja invalida
             }
+            if (consultou)
+            {
+                // Tempo da consulta e da listagem dos resultados, também somado ao relatório --stats
+                static const char *const nomes_pesquisas[] = {"", "maior", "extensao", "vazias", "maiores",
+                                                              "pasta-mais-arquivos", "nome", "k-maiores", "entre", "padrao",
+                                                              "duplicados"};
+                double ms = instrumentacao.registrarConsulta(nomes_pesquisas[sub_opcao], inicio_consulta, resultados);
+                cout << "(" << resultados << " resultado(s) em " << ms << " ms)\n";
+            }
             break;
         }
 
@@ -513,10 +6974,87 @@ int main(int argc, char *argv[])
             cout << "\nSaindo...\n";
             break;
 
+        case 5:
+        {
+            string caminho_pasta;
+            cout << "Pasta (caminho completo ou relativo a raiz): ";
+            cin >> ws;
+            getline(cin, caminho_pasta);
+            uint32_t id;
+            bool encontrada;
+            {
+                shared_lock<shared_mutex> leitura(trava_arvore);
+                id = arvore.localizar(caminho_pasta);
+                encontrada = id != ArvoreArquivos::SEM_PAI && !arvore.ehArquivo(id);
+            }
+            if (!encontrada)
+            {
+                cout << "\nPasta nao encontrada na arvore.\n";
+                break;
+            }
+            instrumentacao.progresso = !sem_progresso && isatty(STDERR_FILENO);
+            recarregarPastas(arvore, trava_arvore, {id}, num_threads, monitor.ativo() ? &monitor : nullptr);
+            instrumentacao.progresso = false;
+            shared_lock<shared_mutex> leitura(trava_arvore);
+            const EstatisticasNo &est = arvore.estatisticas(id);
+            cout << "\nPasta recarregada: " << arvore.caminho(id) << " (" << est.num_arquivos << " arquivos, "
+                 << est.tamanho_total << " bytes)\n";
+            break;
+        }
+
+        case 6:
+        {
+            string arquivo_saida;
+            cout << "Arquivo do snapshot: ";
+            cin >> ws;
+            getline(cin, arquivo_saida);
+            preenchedor.aguardar(); // o snapshot guarda os tamanhos completos
+            shared_lock<shared_mutex> leitura(trava_arvore);
+            if (arvore.salvarSnapshot(arquivo_saida))
+            {
+                cout << "\nSnapshot salvo: " << arquivo_saida << "\n";
+            }
+            else
+            {
+                cout << "\nErro ao salvar snapshot!\n";
+            }
+            break;
+        }
+
+        case 7:
+        {
+            string origem, erro;
+            cout << "Snapshot ou pasta de referencia (a arvore atual e a nova): ";
+            cin >> ws;
+            getline(cin, origem);
+            ArvoreArquivos referencia;
+            if (!carregarReferencia(origem, num_threads, arvore.usoDisco(), referencia, erro))
+            {
+                cout << "\nErro ao abrir \"" << origem << "\": " << (erro.empty() ? "nao e pasta nem snapshot" : erro) << "\n";
+                break;
+            }
+            cout << "\n" << flush;
+            shared_lock<shared_mutex> leitura(trava_arvore);
+            auto inicio_diff = chrono::steady_clock::now();
+            ResumoDiferencas resumo;
+            {
+                EscritorBuffer saida(stdout);
+                resumo = compararArvores(referencia, arvore, saida);
+            }
+            fflush(stdout);
+            double ms = instrumentacao.registrarConsulta("diff", inicio_diff, resumo.adicionados + resumo.removidos + resumo.alterados);
+            cout << resumo.adicionados << " adicionado(s), " << resumo.removidos << " removido(s), " << resumo.alterados
+                 << " alterado(s), delta " << resumo.delta << " bytes (" << ms << " ms)\n";
+            break;
+        }
+
         default:                                 // default captura qualquer entrada inválida do menu principal
             cout << "\nOpcao invalida!\n";   
         }
     } while (opcao_usuario != 4);                // o programa continua executando enquanto o usuário não escolher sair
 
+    preenchedor.parar();
+    monitor.parar();
+    gravarRelatorio(&arvore);
     return 0;
 }